@@ -0,0 +1,191 @@
+#include "compressed_adjacency.h"
+#include <algorithm>
+
+static uint32_t floatBits(float w)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &w, sizeof(bits));
+    return bits;
+}
+
+void CompressedAdjacency::build(const std::vector<std::vector<std::pair<vertex_t, float>>> &adj)
+{
+    V = adj.size();
+    palette.clear();
+    palette_index.clear();
+    data.clear();
+    garbage = 0;
+
+    // Pick the narrowest weight code that covers every distinct weight
+    for (const auto &list : adj)
+    {
+        for (const auto &neighbor : list)
+        {
+            if (palette_index.size() > 65536)
+                break;
+            palette_index.emplace(floatBits(neighbor.second), 0);
+        }
+    }
+    weight_bytes = palette_index.size() <= 256 ? 1 : (palette_index.size() <= 65536 ? 2 : 4);
+    palette_index.clear();
+
+    offsets.assign(V, 0);
+    degrees.assign(V, 0);
+    std::vector<std::pair<vertex_t, float>> sorted;
+    for (vertex_t v = 0; v < V; v++)
+    {
+        sorted.assign(adj[v].begin(), adj[v].end());
+        std::sort(sorted.begin(), sorted.end());
+        for (const auto &neighbor : sorted)
+            weightCode(neighbor.second);
+        offsets[v] = data.size();
+        degrees[v] = sorted.size();
+        encode(sorted, data);
+    }
+    data.shrink_to_fit();
+}
+
+uint32_t CompressedAdjacency::weightCode(float w)
+{
+    if (weight_bytes == 4)
+        return 0;
+
+    auto it = palette_index.find(floatBits(w));
+    if (it != palette_index.end())
+        return it->second;
+
+    size_t capacity = (weight_bytes == 1) ? 256 : 65536;
+    if (palette.size() == capacity)
+    {
+        reencode(weight_bytes == 1 ? 2 : 4);
+        if (weight_bytes == 4)
+            return 0;
+    }
+    uint32_t code = palette.size();
+    palette.push_back(w);
+    palette_index.emplace(floatBits(w), code);
+    return code;
+}
+
+void CompressedAdjacency::encode(const std::vector<std::pair<vertex_t, float>> &list, std::vector<uint8_t> &out)
+{
+    // list must be sorted by neighbour and every weight must have a code
+    vertex_t previous = 0;
+    for (const auto &neighbor : list)
+    {
+        uint64_t gap = neighbor.first - previous;
+        previous = neighbor.first;
+        while (gap >= 0x80)
+        {
+            out.push_back(static_cast<uint8_t>(gap) | 0x80);
+            gap >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(gap));
+
+        if (weight_bytes == 4)
+        {
+            uint32_t bits = floatBits(neighbor.second);
+            for (int i = 0; i < 4; i++)
+                out.push_back(static_cast<uint8_t>(bits >> (8 * i)));
+        }
+        else
+        {
+            uint32_t code = palette_index.at(floatBits(neighbor.second));
+            out.push_back(static_cast<uint8_t>(code));
+            if (weight_bytes == 2)
+                out.push_back(static_cast<uint8_t>(code >> 8));
+        }
+    }
+}
+
+void CompressedAdjacency::decode(vertex_t v, std::vector<std::pair<vertex_t, float>> &out) const
+{
+    out.clear();
+    out.reserve(degrees[v]);
+    forEach(v, [&](vertex_t u, float w)
+            { out.emplace_back(u, w); });
+}
+
+uint64_t CompressedAdjacency::listBytes(vertex_t v) const
+{
+    const uint8_t *p = data.data() + offsets[v];
+    const uint8_t *start = p;
+    for (uint32_t i = 0; i < degrees[v]; i++)
+    {
+        while (*p++ & 0x80)
+            ;
+        p += weight_bytes;
+    }
+    return p - start;
+}
+
+void CompressedAdjacency::setNeighbors(vertex_t v, std::vector<std::pair<vertex_t, float>> &list)
+{
+    std::sort(list.begin(), list.end());
+    // Assign codes first: a palette overflow re-encodes every list
+    for (const auto &neighbor : list)
+        weightCode(neighbor.second);
+
+    garbage += listBytes(v);
+    offsets[v] = data.size();
+    degrees[v] = list.size();
+    encode(list, data);
+
+    if (garbage > data.size() / 2)
+        compact();
+}
+
+float CompressedAdjacency::find(vertex_t v, vertex_t target) const
+{
+    float found = -1.0f;
+    forEach(v, [&](vertex_t u, float w)
+            {
+                if (u == target && found < 0)
+                    found = w; });
+    return found;
+}
+
+void CompressedAdjacency::reencode(int new_weight_bytes)
+{
+    std::vector<uint8_t> new_data;
+    new_data.reserve(data.size() - garbage);
+    std::vector<std::pair<vertex_t, float>> list;
+    int old_weight_bytes = weight_bytes;
+    for (vertex_t v = 0; v < V; v++)
+    {
+        decode(v, list);
+        weight_bytes = new_weight_bytes;
+        offsets[v] = new_data.size();
+        encode(list, new_data);
+        weight_bytes = old_weight_bytes;
+    }
+    weight_bytes = new_weight_bytes;
+    if (weight_bytes == 4)
+    {
+        palette.clear();
+        palette_index.clear();
+    }
+    data.swap(new_data);
+    garbage = 0;
+}
+
+void CompressedAdjacency::compact()
+{
+    std::vector<uint8_t> new_data;
+    new_data.reserve(data.size() - garbage);
+    for (vertex_t v = 0; v < V; v++)
+    {
+        uint64_t bytes = listBytes(v);
+        uint64_t start = new_data.size();
+        new_data.insert(new_data.end(), data.begin() + offsets[v], data.begin() + offsets[v] + bytes);
+        offsets[v] = start;
+    }
+    data.swap(new_data);
+    garbage = 0;
+}
+
+uint64_t CompressedAdjacency::memoryBytes() const
+{
+    return data.capacity() + offsets.capacity() * sizeof(uint64_t) +
+           degrees.capacity() * sizeof(uint32_t) + palette.capacity() * sizeof(float);
+}
@@ -0,0 +1,83 @@
+#ifndef COMPRESSED_ADJACENCY_H
+#define COMPRESSED_ADJACENCY_H
+
+#include "sssp_types.h"
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Byte-packed adjacency lists. Each vertex's neighbours are sorted and
+// stored as varint gaps, each followed by a weight code: an index into a
+// palette of distinct weights (1 or 2 bytes), or the raw float once there
+// are more than 65536 distinct weights. Palette coding is exact, so results
+// match the uncompressed graph.
+//
+// Rewritten lists are appended to the end of data; the old bytes become
+// garbage and are compacted away once they make up half the buffer.
+class CompressedAdjacency
+{
+public:
+    vertex_t V = 0;
+    std::vector<uint64_t> offsets; // Start of each vertex's list in data
+    std::vector<uint32_t> degrees;
+    std::vector<uint8_t> data;
+    uint64_t garbage = 0;
+
+    std::vector<float> palette;
+    std::unordered_map<uint32_t, uint32_t> palette_index; // float bits -> code
+    int weight_bytes = 1;
+
+    void build(const std::vector<std::vector<std::pair<vertex_t, float>>> &adj);
+    void decode(vertex_t v, std::vector<std::pair<vertex_t, float>> &out) const;
+    void setNeighbors(vertex_t v, std::vector<std::pair<vertex_t, float>> &list);
+    float find(vertex_t v, vertex_t target) const;
+    uint64_t memoryBytes() const;
+
+    template <typename F>
+    void forEach(vertex_t v, F &&f) const
+    {
+        const uint8_t *p = data.data() + offsets[v];
+        vertex_t u = 0;
+        for (uint32_t i = 0; i < degrees[v]; i++)
+        {
+            uint64_t gap = 0;
+            int shift = 0;
+            uint8_t b;
+            do
+            {
+                b = *p++;
+                gap |= static_cast<uint64_t>(b & 0x7f) << shift;
+                shift += 7;
+            } while (b & 0x80);
+            u += gap;
+
+            float w;
+            if (weight_bytes == 1)
+            {
+                w = palette[p[0]];
+                p += 1;
+            }
+            else if (weight_bytes == 2)
+            {
+                w = palette[p[0] | (p[1] << 8)];
+                p += 2;
+            }
+            else
+            {
+                std::memcpy(&w, p, sizeof(float));
+                p += 4;
+            }
+            f(u, w);
+        }
+    }
+
+    uint32_t weightCode(float w);
+    void encode(const std::vector<std::pair<vertex_t, float>> &list, std::vector<uint8_t> &out);
+    uint64_t listBytes(vertex_t v) const;
+    void reencode(int new_weight_bytes);
+    void compact();
+};
+
+#endif // COMPRESSED_ADJACENCY_H
@@ -0,0 +1,307 @@
+#include "contraction_hierarchy.h"
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <omp.h>
+
+void ContractionHierarchy::build(vertex_t num_vertices, const std::vector<Edge> &edges,
+                                 const std::vector<vertex_t> &ranks, bool use_openmp)
+{
+    V = num_vertices;
+    rank = ranks;
+    order.assign(V, -1);
+    for (vertex_t v = 0; v < V; v++)
+        order[rank[v]] = v;
+
+    // Symbolic elimination: x's higher neighbours become a clique, and since
+    // they are all joined to the lowest of them, handing that one the rest
+    // is enough. Its own turn comes later and passes them on again.
+    std::vector<std::vector<vertex_t>> up(V);
+    for (const Edge &e : edges)
+    {
+        if (e.u < 0 || e.u >= V || e.v < 0 || e.v >= V || e.u == e.v || e.weight < 0)
+            continue;
+        vertex_t a = rank[e.u], b = rank[e.v];
+        up[std::min(a, b)].push_back(std::max(a, b));
+    }
+    etree.assign(V, -1);
+    for (vertex_t x = 0; x < V; x++)
+    {
+        auto &heads = up[x];
+        std::sort(heads.begin(), heads.end());
+        heads.erase(std::unique(heads.begin(), heads.end()), heads.end());
+        if (heads.empty())
+            continue;
+        etree[x] = heads[0];
+        auto &parent = up[heads[0]];
+        parent.insert(parent.end(), heads.begin() + 1, heads.end());
+    }
+
+    up_offsets.assign(V + 1, 0);
+    for (vertex_t x = 0; x < V; x++)
+        up_offsets[x + 1] = up_offsets[x] + up[x].size();
+    up_heads.resize(up_offsets[V]);
+    for (vertex_t x = 0; x < V; x++)
+    {
+        std::copy(up[x].begin(), up[x].end(), up_heads.begin() + up_offsets[x]);
+        std::vector<vertex_t>().swap(up[x]);
+    }
+
+    // Downward lists come out sorted by tail because tails are visited in order
+    down_offsets.assign(V + 1, 0);
+    for (vertex_t h : up_heads)
+        down_offsets[h + 1]++;
+    for (vertex_t x = 0; x < V; x++)
+        down_offsets[x + 1] += down_offsets[x];
+    down_arcs.resize(up_heads.size());
+    std::vector<size_t> fill(down_offsets.begin(), down_offsets.end() - 1);
+    for (vertex_t x = 0; x < V; x++)
+    {
+        for (size_t a = up_offsets[x]; a < up_offsets[x + 1]; a++)
+            down_arcs[fill[up_heads[a]]++] = {x, a};
+    }
+
+    // A vertex sits one level above its highest lower neighbour
+    std::vector<vertex_t> level(V, 0);
+    vertex_t num_levels = V > 0 ? 1 : 0;
+    for (vertex_t x = 0; x < V; x++)
+    {
+        for (size_t a = up_offsets[x]; a < up_offsets[x + 1]; a++)
+            level[up_heads[a]] = std::max(level[up_heads[a]], level[x] + 1);
+        num_levels = std::max(num_levels, level[x] + 1);
+    }
+    level_offsets.assign(num_levels + 1, 0);
+    for (vertex_t x = 0; x < V; x++)
+        level_offsets[level[x] + 1]++;
+    for (vertex_t l = 0; l < num_levels; l++)
+        level_offsets[l + 1] += level_offsets[l];
+    level_ranks.resize(V);
+    fill.assign(level_offsets.begin(), level_offsets.end() - 1);
+    for (vertex_t x = 0; x < V; x++)
+        level_ranks[fill[level[x]]++] = x;
+
+    // Parallel edges keep the lightest weight
+    input.assign(up_heads.size(), std::numeric_limits<float>::infinity());
+    for (const Edge &e : edges)
+    {
+        if (e.u < 0 || e.u >= V || e.v < 0 || e.v >= V || e.u == e.v || e.weight < 0)
+            continue;
+        vertex_t a = rank[e.u], b = rank[e.v];
+        size_t arc = findArc(std::min(a, b), std::max(a, b));
+        input[arc] = std::min(input[arc], e.weight);
+    }
+    metric = input;
+    customize(use_openmp);
+}
+
+size_t ContractionHierarchy::findArc(vertex_t lower, vertex_t higher) const
+{
+    auto first = up_heads.begin() + up_offsets[lower];
+    auto last = up_heads.begin() + up_offsets[lower + 1];
+    auto it = std::lower_bound(first, last, higher);
+    if (it == last || *it != higher)
+        return up_heads.size();
+    return it - up_heads.begin();
+}
+
+void ContractionHierarchy::customize(bool use_openmp)
+{
+    std::vector<char> dirty(V, 1);
+    customize(dirty, use_openmp);
+}
+
+// Rewrites every arc leaving a dirty vertex from its input weight and lower
+// triangles, level by level so the triangles' arcs are already final. An
+// arc (x, h) lies in the triangles of every arc between h and another upward
+// neighbour of x, so a change dirties all of x's heads.
+void ContractionHierarchy::customize(std::vector<char> &dirty, bool use_openmp)
+{
+    long long rewritten = 0;
+    for (size_t l = 0; l + 1 < level_offsets.size(); l++)
+    {
+#pragma omp parallel for schedule(dynamic, 64) reduction(+ : rewritten) if (use_openmp)
+        for (size_t i = level_offsets[l]; i < level_offsets[l + 1]; i++)
+        {
+            vertex_t x = level_ranks[i];
+            if (!dirty[x])
+                continue;
+            dirty[x] = 0;
+
+            bool changed = false;
+            for (size_t a = up_offsets[x]; a < up_offsets[x + 1]; a++)
+            {
+                vertex_t h = up_heads[a];
+                float m = input[a];
+                auto i1 = down_arcs.begin() + down_offsets[x], e1 = down_arcs.begin() + down_offsets[x + 1];
+                auto i2 = down_arcs.begin() + down_offsets[h], e2 = down_arcs.begin() + down_offsets[h + 1];
+                while (i1 != e1 && i2 != e2)
+                {
+                    if (i1->first < i2->first)
+                        ++i1;
+                    else if (i2->first < i1->first)
+                        ++i2;
+                    else
+                    {
+                        m = std::min(m, metric[i1->second] + metric[i2->second]);
+                        ++i1;
+                        ++i2;
+                    }
+                }
+                rewritten++;
+                if (m != metric[a])
+                {
+                    metric[a] = m;
+                    changed = true;
+                }
+            }
+            if (!changed)
+                continue;
+            for (size_t a = up_offsets[x]; a < up_offsets[x + 1]; a++)
+            {
+#pragma omp atomic write
+                dirty[up_heads[a]] = 1;
+            }
+        }
+    }
+    last_customized = rewritten;
+}
+
+bool ContractionHierarchy::applyUpdates(const std::vector<Edge> &updates, bool use_openmp)
+{
+    const float INF = std::numeric_limits<float>::infinity();
+    std::vector<char> dirty(V, 0);
+    for (size_t i = 0; i < updates.size(); i++)
+    {
+        const Edge &e = updates[i];
+        if (e.u < 0 || e.u >= V || e.v < 0 || e.v >= V || e.u == e.v)
+            continue;
+        vertex_t a = rank[e.u], b = rank[e.v];
+        vertex_t lower = std::min(a, b);
+        size_t arc = findArc(lower, std::max(a, b));
+        if (arc != up_heads.size())
+        {
+            input[arc] = e.weight < 0 ? INF : e.weight;
+            dirty[lower] = 1;
+            continue;
+        }
+        if (e.weight < 0)
+            continue;
+
+        // The edge falls outside the chordal supergraph. Contract again in
+        // the same order from every edge the hierarchy holds, with the rest
+        // of the batch applied on top.
+        std::map<std::pair<vertex_t, vertex_t>, float> weights;
+        for (vertex_t x = 0; x < V; x++)
+        {
+            for (size_t j = up_offsets[x]; j < up_offsets[x + 1]; j++)
+            {
+                if (input[j] != INF)
+                    weights[{x, up_heads[j]}] = input[j];
+            }
+        }
+        for (size_t j = i; j < updates.size(); j++)
+        {
+            const Edge &r = updates[j];
+            if (r.u < 0 || r.u >= V || r.v < 0 || r.v >= V || r.u == r.v)
+                continue;
+            std::pair<vertex_t, vertex_t> key = std::minmax(rank[r.u], rank[r.v]);
+            if (r.weight < 0)
+                weights.erase(key);
+            else
+                weights[key] = r.weight;
+        }
+        std::vector<Edge> edges;
+        edges.reserve(weights.size());
+        for (const auto &[key, weight] : weights)
+            edges.push_back({order[key.first], order[key.second], weight});
+        std::vector<vertex_t> ranks = std::move(rank);
+        build(V, edges, ranks, use_openmp);
+        return true;
+    }
+    customize(dirty, use_openmp);
+    return false;
+}
+
+void ContractionHierarchy::upwardSearch(vertex_t x, std::vector<float> &dist,
+                                        std::vector<vertex_t> &reached) const
+{
+    // Every upward arc of an ancestor leads to another ancestor, so the
+    // search space is the elimination-tree path, already in rank order
+    reached.clear();
+    for (vertex_t y = x; y >= 0; y = etree[y])
+        reached.push_back(y);
+    dist.assign(reached.size(), std::numeric_limits<float>::infinity());
+    dist[0] = 0;
+    for (size_t i = 0; i < reached.size(); i++)
+    {
+        vertex_t y = reached[i];
+        for (size_t a = up_offsets[y]; a < up_offsets[y + 1]; a++)
+        {
+            size_t j = std::lower_bound(reached.begin() + i, reached.end(), up_heads[a]) - reached.begin();
+            dist[j] = std::min(dist[j], dist[i] + metric[a]);
+        }
+    }
+}
+
+void ContractionHierarchy::distancesFrom(vertex_t source, std::vector<float> &dist, bool use_openmp) const
+{
+    const float INF = std::numeric_limits<float>::infinity();
+    std::vector<float> d(V, INF);
+    if (source >= 0 && source < V)
+    {
+        std::vector<float> up_dist;
+        std::vector<vertex_t> reached;
+        upwardSearch(rank[source], up_dist, reached);
+        for (size_t i = 0; i < reached.size(); i++)
+            d[reached[i]] = up_dist[i];
+
+        // PHAST: from the top level down, each vertex takes the best of its
+        // upward neighbours, which are all final by then
+        for (size_t l = level_offsets.size() - 1; l-- > 0;)
+        {
+#pragma omp parallel for schedule(dynamic, 256) if (use_openmp)
+            for (size_t i = level_offsets[l]; i < level_offsets[l + 1]; i++)
+            {
+                vertex_t x = level_ranks[i];
+                float best = d[x];
+                for (size_t a = up_offsets[x]; a < up_offsets[x + 1]; a++)
+                    best = std::min(best, d[up_heads[a]] + metric[a]);
+                d[x] = best;
+            }
+        }
+    }
+    dist.resize(V);
+    for (vertex_t v = 0; v < V; v++)
+        dist[v] = d[rank[v]];
+}
+
+std::vector<float> ContractionHierarchy::distancesTo(vertex_t source, const std::vector<vertex_t> &targets) const
+{
+    const float INF = std::numeric_limits<float>::infinity();
+    std::vector<float> result(targets.size(), INF);
+    if (source < 0 || source >= V)
+        return result;
+
+    std::vector<float> from_dist, to_dist;
+    std::vector<vertex_t> from_reached, to_reached;
+    upwardSearch(rank[source], from_dist, from_reached);
+    for (size_t t = 0; t < targets.size(); t++)
+    {
+        if (targets[t] < 0 || targets[t] >= V)
+            continue;
+        upwardSearch(rank[targets[t]], to_dist, to_reached);
+
+        // Both paths climb the same tree, so they meet at every common ancestor
+        size_t i = 0, j = 0;
+        while (i < from_reached.size() && j < to_reached.size())
+        {
+            if (from_reached[i] < to_reached[j])
+                i++;
+            else if (to_reached[j] < from_reached[i])
+                j++;
+            else
+                result[t] = std::min(result[t], from_dist[i++] + to_dist[j++]);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,66 @@
+#ifndef CONTRACTION_HIERARCHY_H
+#define CONTRACTION_HIERARCHY_H
+
+#include "graph.h"
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Customizable contraction hierarchy (CCH). Vertices are eliminated in a
+// nested-dissection order; eliminating a vertex joins its higher-ranked
+// neighbours into a clique, and those arcs, shortcuts included, depend only
+// on the topology. Customization then gives every arc the length of the
+// shortest path through lower-ranked vertices, which needs only the arcs'
+// lower triangles and is cheap to redo when weights change.
+//
+// Everything below is indexed by rank (elimination position), not vertex.
+// Upward arcs of x go to higher ranks, sorted; an arc's lower triangles are
+// the common lower neighbours of its two ends. Vertices share a level when
+// neither lies below the other, so a level is customized in parallel.
+class ContractionHierarchy
+{
+public:
+    vertex_t V = 0;
+    std::vector<vertex_t> rank;  // Rank of each vertex
+    std::vector<vertex_t> order; // Vertex of each rank
+
+    std::vector<size_t> up_offsets;
+    std::vector<vertex_t> up_heads;
+    std::vector<size_t> down_offsets;
+    std::vector<std::pair<vertex_t, size_t>> down_arcs; // (lower neighbour, its arc to here)
+    std::vector<vertex_t> etree;                        // Lowest upward neighbour, -1 at a root
+
+    std::vector<size_t> level_offsets;
+    std::vector<vertex_t> level_ranks; // Ranks grouped by level, lowest level first
+
+    std::vector<float> input;  // Edge weight per arc, infinity for shortcuts
+    std::vector<float> metric; // Customized length per arc
+
+    long long last_customized = 0; // Arcs the last customization rewrote
+
+    bool built() const { return V > 0; }
+
+    // Contracts V vertices with these edges in the given order (ranks[v] =
+    // rank of v) and customizes the result with the edges' weights
+    void build(vertex_t V, const std::vector<Edge> &edges, const std::vector<vertex_t> &ranks,
+               bool use_openmp);
+
+    // Weight changes, deletions (negative weight) and insertions, then
+    // re-customization of the arcs they affect. An insertion between two
+    // vertices without an arc contracts again in the same order; returns
+    // true if that happened.
+    bool applyUpdates(const std::vector<Edge> &updates, bool use_openmp);
+
+    // Every distance from source (by vertex), into dist
+    void distancesFrom(vertex_t source, std::vector<float> &dist, bool use_openmp) const;
+
+    // Distances from source to each target
+    std::vector<float> distancesTo(vertex_t source, const std::vector<vertex_t> &targets) const;
+
+    void customize(bool use_openmp);
+    void customize(std::vector<char> &dirty, bool use_openmp);
+    size_t findArc(vertex_t lower, vertex_t higher) const;
+    void upwardSearch(vertex_t x, std::vector<float> &dist, std::vector<vertex_t> &reached) const;
+};
+
+#endif // CONTRACTION_HIERARCHY_H
@@ -0,0 +1,430 @@
+#include "dynamic_sssp.h"
+#include "update_batch.h"
+#include "mpi_chunked.h"
+#include <algorithm>
+#include <limits>
+#include <iostream>
+
+DynamicSSSP::DynamicSSSP(MPI_Comm comm, const DynamicSSSPOptions &options)
+    : comm(comm), options(options), sssp(0)
+{
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    edge_type = createEdgeType();
+    sssp.comm = comm;
+    sssp.direction = options.direction;
+
+    // Pin before anything is first-touched, so pages stay with their threads
+    if (options.use_openmp)
+    {
+        if (options.pin_threads)
+            pinThreads();
+        reportThreadPlacement(comm);
+    }
+}
+
+DynamicSSSP::~DynamicSSSP()
+{
+    MPI_Type_free(&edge_type);
+}
+
+bool DynamicSSSP::loadGraph(const std::string &filename)
+{
+    if (options.parallel_load)
+    {
+        graph.loadFromFileParallel(filename, comm, edge_type);
+    }
+    else
+    {
+        if (rank == 0)
+            graph.loadFromFile(filename);
+        if (!distributeFromRoot())
+            return false;
+    }
+
+    if (graph.V == 0)
+        return false;
+    finishGraph();
+    return true;
+}
+
+bool DynamicSSSP::buildGraph(vertex_t V, const std::vector<Edge> &edges)
+{
+    if (rank == 0)
+    {
+        graph = Graph();
+        graph.V = V;
+        graph.adj.resize(V);
+        for (const auto &e : edges)
+        {
+            if (e.u < 0 || e.u >= V || e.v < 0 || e.v >= V || e.u == e.v)
+            {
+                std::cerr << "Warning: Skipping invalid edge " << e.u << " " << e.v << std::endl;
+                continue;
+            }
+            graph.addEdge(e.u, e.v, e.weight);
+        }
+    }
+    if (!distributeFromRoot() || graph.V == 0)
+        return false;
+    finishGraph();
+    return true;
+}
+
+void DynamicSSSP::saveGraph(const std::string &filename)
+{
+    graph.saveBinary(filename, comm);
+}
+
+bool DynamicSSSP::distributeFromRoot()
+{
+    // Rank 0 holds the whole graph; partition it and replicate to the others
+    if (rank == 0 && graph.V > 0)
+    {
+        if (size > 1)
+            graph.partitionGraph(size);
+        else
+            graph.part.assign(graph.V, 0);
+    }
+
+    int64_t graph_info[2] = {graph.V, static_cast<int64_t>(graph.edges.size())};
+    MPI_Bcast(graph_info, 2, MPI_INT64_T, 0, comm);
+    if (graph_info[0] <= 0)
+        return false;
+
+    if (rank != 0)
+    {
+        graph = Graph();
+        graph.V = graph_info[0];
+        graph.adj.resize(graph.V);
+        graph.part.resize(graph.V);
+        graph.edges.resize(graph_info[1]);
+    }
+    graph.E = graph_info[1];
+
+    bcastChunked(graph.part.data(), graph.V, MPI_INT, 0, comm);
+    bcastChunked(graph.edges.data(), graph.E, edge_type, 0, comm);
+
+    if (rank != 0)
+    {
+        for (const auto &edge : graph.edges)
+        {
+            graph.adj[edge.u].emplace_back(edge.v, edge.weight);
+            graph.adj[edge.v].emplace_back(edge.u, edge.weight);
+        }
+    }
+    return true;
+}
+
+void DynamicSSSP::finishGraph()
+{
+    graph.distributeGraph(comm);
+    source = -1;
+    if (options.use_openmp && !options.compress_graph)
+        graph.placeAdjacency();
+
+    // Contracted from the edge list, so before compression drops it
+    cch = ContractionHierarchy();
+    if (options.use_cch)
+        buildHierarchy();
+
+    if (options.compress_graph)
+    {
+        double before = graph.compress();
+        double after = graph.cadj.memoryBytes();
+        double totals[2] = {before, after};
+        MPI_Allreduce(MPI_IN_PLACE, totals, 2, MPI_DOUBLE, MPI_SUM, comm);
+        if (rank == 0)
+        {
+            std::cout << "Compressed adjacency: " << totals[0] / (1024.0 * 1024.0) << " MB -> "
+                      << totals[1] / (1024.0 * 1024.0) << " MB over all ranks ("
+                      << graph.cadj.weight_bytes << "-byte weights)" << std::endl;
+        }
+    }
+}
+
+void DynamicSSSP::buildHierarchy()
+{
+    if (options.parallel_load)
+    {
+        if (rank == 0)
+            std::cerr << "Warning: use_cch needs the whole graph on every rank; ignored with parallel_load" << std::endl;
+        return;
+    }
+
+    // The order depends only on the topology, so weight changes never
+    // redo this part
+    std::vector<vertex_t> order;
+    if (rank == 0)
+        order = graph.nestedDissectionOrder();
+    else
+        order.resize(graph.V);
+    bcastChunked(order.data(), graph.V, MPI_VERTEX_T, 0, comm);
+    cch.build(graph.V, graph.edges, order, options.use_openmp);
+
+    if (rank == 0)
+    {
+        std::cout << "Contraction hierarchy: " << cch.up_heads.size() << " arcs for "
+                  << graph.E << " edges, " << cch.level_offsets.size() - 1 << " levels" << std::endl;
+    }
+}
+
+// Fills the tree from the hierarchy's distances. Each local vertex takes the
+// neighbour its distance came through, so parents follow current edges.
+void DynamicSSSP::solveOnHierarchy()
+{
+    const float INF = std::numeric_limits<float>::infinity();
+    std::vector<float> dist;
+    cch.distancesFrom(source, dist, options.use_openmp);
+    std::copy(dist.begin(), dist.end(), sssp.dist.begin());
+
+#pragma omp parallel for schedule(dynamic, 256) if (options.use_openmp)
+    for (size_t i = 0; i < graph.local_vertices.size(); i++)
+    {
+        vertex_t v = graph.local_vertices[i];
+        vertex_t best = -1;
+        if (v != source && dist[v] != INF)
+        {
+            float best_dist = INF;
+            graph.forEachNeighbor(v, [&](vertex_t u, float weight)
+                                  {
+                                      if (dist[u] + weight < best_dist)
+                                      {
+                                          best_dist = dist[u] + weight;
+                                          best = u;
+                                      } });
+        }
+        sssp.parent[v] = best;
+    }
+}
+
+void DynamicSSSP::solveFromScratch(bool use_device)
+{
+    // Batches may cut corners, a tree built from nothing does not
+    sssp.initialize(source, options.use_openmp);
+    sssp.epsilon = 0;
+    sssp.updateStep2(graph, options.use_openmp, options.async_level, use_device);
+    sssp.epsilon = std::max(0.0f, options.epsilon);
+}
+
+bool DynamicSSSP::setSource(vertex_t source)
+{
+    if (source < 0 || source >= graph.V)
+    {
+        if (rank == 0)
+            std::cerr << "Error: Invalid source vertex " << source << std::endl;
+        return false;
+    }
+
+    this->source = source;
+    sssp.resize(graph.V, options.use_openmp);
+    if (cch.built())
+    {
+        sssp.initialize(source, options.use_openmp);
+        solveOnHierarchy();
+    }
+    else
+        solveFromScratch(options.use_opencl);
+    publishResults(true);
+    alt.select(graph, sssp.dist, options.landmarks, comm, options.use_openmp, options.async_level);
+    return true;
+}
+
+BatchStats DynamicSSSP::applyBatch(const std::vector<Edge> &updates)
+{
+    BatchStats stats;
+    if (source < 0)
+    {
+        if (rank == 0)
+            std::cerr << "Error: applyBatch called before setSource" << std::endl;
+        return stats;
+    }
+
+    // Coalesce the batch on rank 0, then hand each rank only the updates
+    // touching its own vertices
+    std::vector<Edge> net;
+    if (rank == 0)
+        net = coalesceUpdates(updates);
+    if (cch.built())
+    {
+        // Every rank re-customizes its copy of the hierarchy
+        int64_t net_size = static_cast<int64_t>(net.size());
+        MPI_Bcast(&net_size, 1, MPI_INT64_T, 0, comm);
+        net.resize(net_size);
+        bcastChunked(net.data(), net_size, edge_type, 0, comm);
+    }
+    std::vector<Edge> my_updates = scatterUpdates(graph, net, edge_type, comm);
+    UpdateBatch batch = classifyUpdates(graph, sssp.parent, my_updates, rank);
+
+    long long counts[6] = {rank == 0 ? static_cast<long long>(net.size()) : 0,
+                           static_cast<long long>(batch.inserts.size()) - batch.decreases,
+                           static_cast<long long>(batch.deletes.size()),
+                           batch.decreases,
+                           static_cast<long long>(batch.increases.size()),
+                           batch.dropped};
+    long long totals[6];
+    MPI_Allreduce(counts, totals, 6, MPI_LONG_LONG, MPI_SUM, comm);
+    stats.coalesced = totals[0];
+    stats.inserts = totals[1];
+    stats.deletes = totals[2];
+    stats.decreases = totals[3];
+    stats.increases = totals[4];
+    stats.dropped = totals[5];
+
+    alt.classify(graph, my_updates, rank);
+    graph.applyUpdates(batch.updates);
+    graph.distributeGraph(comm);
+
+    BatchPlan plan;
+    if (cch.built())
+    {
+        // The hierarchy answers every batch; there is nothing to plan
+        stats.strategy = UPDATE_HIERARCHY;
+        if (rank == 0)
+            std::cout << "Batch plan: " << strategyName(stats.strategy) << " - use_cch" << std::endl;
+    }
+    else
+    {
+        if (options.cost_model)
+            plan = planBatch(graph, tree, batch, options.use_opencl, comm);
+        else
+        {
+            plan.strategy = options.use_opencl ? UPDATE_DEVICE : UPDATE_INCREMENTAL;
+            plan.reason = "cost model off";
+        }
+        stats.strategy = plan.strategy;
+        stats.estimated_affected = plan.affected;
+        if (rank == 0)
+        {
+            std::cout << "Batch plan: " << strategyName(plan.strategy);
+            if (plan.strategy == UPDATE_DEVICE)
+                std::cout << (plan.recompute ? " (full recompute)" : " (incremental)");
+            std::cout << " - " << plan.reason << std::endl;
+        }
+    }
+
+    // Counts the tree update and publishing only; the stages above allocate
+    long long allocations = heapAllocations();
+    if (cch.built())
+    {
+        bool rebuilt = cch.applyUpdates(net, options.use_openmp);
+        stats.customized = rebuilt ? -1 : cch.last_customized;
+        solveOnHierarchy();
+    }
+    else if (plan.recompute)
+    {
+        sssp.reparented = sssp.spared = sssp.skipped = 0;
+        solveFromScratch(plan.strategy == UPDATE_DEVICE);
+    }
+    else
+    {
+        bool use_device = plan.strategy == UPDATE_DEVICE;
+        sssp.updateStep1(graph, batch.inserts, batch.deletes, batch.increases,
+                         options.use_openmp, use_device);
+        sssp.updateStep2(graph, options.use_openmp, options.async_level, use_device);
+        long long work[3] = {sssp.reparented, sssp.spared, sssp.skipped};
+        MPI_Allreduce(MPI_IN_PLACE, work, 3, MPI_LONG_LONG, MPI_SUM, comm);
+        stats.reparented = work[0];
+        stats.spared = work[1];
+        stats.skipped = work[2];
+    }
+    publishResults(false);
+    MPI_Allreduce(&snapshots.last_copied, &stats.snapshot_pages, 1, MPI_LONG_LONG, MPI_MAX, comm);
+    if (allocations >= 0)
+    {
+        allocations = heapAllocations() - allocations;
+        MPI_Allreduce(&allocations, &stats.allocations, 1, MPI_LONG_LONG, MPI_MAX, comm);
+    }
+
+    // The landmark trees only serve queryTargets(), so they are repaired
+    // after the main tree is published
+    alt.update(graph, comm, options.use_openmp, options.async_level);
+    return stats;
+}
+
+void DynamicSSSP::publishResults(bool rebuild_tree)
+{
+    result_dist.assign(sssp.dist.begin(), sssp.dist.end());
+    result_parent.assign(sssp.parent.begin(), sssp.parent.end());
+    if (size > 1 && options.replicate_results)
+    {
+        graph.gatherSSSPResults(comm, result_dist);
+
+        // Parents follow the same owner-only rule; -1 loses against any vertex
+        for (vertex_t v = 0; v < graph.V; v++)
+        {
+            if (graph.part[v] != rank)
+                result_parent[v] = -1;
+        }
+        allreduceChunked(MPI_IN_PLACE, result_parent.data(), graph.V, MPI_VERTEX_T, MPI_MAX, comm);
+    }
+    snapshots.publish(result_dist, result_parent);
+    if (!options.replicate_results && size > 1)
+        return;
+
+    // Only subtrees whose root changed parent are re-indexed after a batch
+    if (rebuild_tree)
+        tree.build(result_parent, source);
+    else
+        tree.update(result_parent);
+}
+
+float DynamicSSSP::distance(vertex_t v) const
+{
+    if (v < 0 || v >= static_cast<vertex_t>(result_dist.size()))
+        return std::numeric_limits<float>::infinity();
+    return result_dist[v];
+}
+
+vertex_t DynamicSSSP::parentOf(vertex_t v) const
+{
+    if (v < 0 || v >= static_cast<vertex_t>(result_parent.size()))
+        return -1;
+    return result_parent[v];
+}
+
+int DynamicSSSP::hopsTo(vertex_t v) const
+{
+    return tree.hops(v);
+}
+
+std::vector<vertex_t> DynamicSSSP::pathTo(vertex_t v) const
+{
+    // Source first, v last; empty if v is unreachable
+    return tree.path(v);
+}
+
+vertex_t DynamicSSSP::commonAncestor(vertex_t u, vertex_t v) const
+{
+    return tree.lca(u, v);
+}
+
+const std::vector<float> &DynamicSSSP::distances() const
+{
+    return result_dist;
+}
+
+SnapshotStore::View DynamicSSSP::snapshot() const
+{
+    return snapshots.acquire();
+}
+
+TargetQuery DynamicSSSP::queryTargets(vertex_t from, const std::vector<vertex_t> &targets)
+{
+    if (source < 0)
+    {
+        if (rank == 0)
+            std::cerr << "Error: queryTargets called before setSource" << std::endl;
+        TargetQuery none;
+        none.dist.assign(targets.size(), std::numeric_limits<float>::infinity());
+        return none;
+    }
+    if (cch.built())
+    {
+        // Replicated, so no rank has to talk to another
+        TargetQuery result;
+        result.dist = cch.distancesTo(from, targets);
+        return result;
+    }
+    return alt.query(graph, from, targets, comm);
+}
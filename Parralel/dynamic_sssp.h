@@ -0,0 +1,143 @@
+#ifndef DYNAMIC_SSSP_H
+#define DYNAMIC_SSSP_H
+
+#include "graph.h"
+#include "sssp.h"
+#include "snapshot.h"
+#include "landmarks.h"
+#include "contraction_hierarchy.h"
+#include "update_batch.h"
+#include "tree_index.h"
+#include <string>
+#include <vector>
+#include <mpi.h>
+
+struct DynamicSSSPOptions
+{
+    bool use_openmp = false;
+    bool use_opencl = false;
+    int async_level = 1;
+    bool parallel_load = false;
+    // Replicate dist/parent on every rank after each batch so queries are
+    // local; without it queries are only valid for locally owned vertices
+    bool replicate_results = true;
+    // Store adjacency as varint/palette-coded lists and drop the edge list
+    bool compress_graph = false;
+    // Pin OpenMP threads to CPUs when OMP_PROC_BIND is not set
+    bool pin_threads = false;
+    // Push/pull choice for the relaxation rounds of Step 2
+    RelaxDirection direction = RELAX_AUTO;
+    // ALT landmarks kept for queryTargets(), each a full tree repaired with
+    // every batch; without any the search has no bound but still stops early
+    int landmarks = 0;
+    // Answer setSource, applyBatch and queryTargets from a customizable
+    // contraction hierarchy over the METIS nested-dissection order instead
+    // of Step 1/Step 2. Every rank holds the whole hierarchy; ignored with
+    // parallel_load.
+    bool use_cch = false;
+    // Approximate batches: a relaxation over an edge of weight w is skipped
+    // unless it improves the distance by more than epsilon * w, which keeps
+    // every distance within a factor of 1 + epsilon of exact. A child cut
+    // off by a deleted or heavier tree edge moves to a detour within that
+    // factor instead of being invalidated. The initial tree stays exact.
+    // 0 is exact.
+    float epsilon = 0;
+    // Let a cost model pick incremental repair, a full recompute or device
+    // offload per batch (planBatch); otherwise batches are always repaired,
+    // on the devices with use_opencl
+    bool cost_model = true;
+};
+
+// Outcome of one applyBatch() call, summed over all ranks
+struct BatchStats
+{
+    long long coalesced = 0; // Net updates after coalescing
+    long long inserts = 0;   // Insertions that reached Step 1
+    long long deletes = 0;   // Tree-edge deletions that reached Step 1
+    long long decreases = 0; // Weight decreases, applied like insertions
+    long long increases = 0; // Tree-edge weight increases that reached Step 1
+    long long reparented = 0; // Increases absorbed without invalidating a subtree
+    long long spared = 0;     // Cut-off children moved to a detour within epsilon
+    long long skipped = 0;    // Relaxations skipped under the epsilon bound
+    UpdateStrategy strategy = UPDATE_INCREMENTAL; // What the batch ran as
+    long long estimated_affected = 0;              // The cost model's estimate
+    long long dropped = 0;   // No-op updates (cut edges count once per owner)
+    // Heap allocations in Step 1/2 and publishing only (most on any rank), or
+    // -1 unless built with -DSSSP_COUNT_ALLOCS. Reading, distributing and
+    // planning the batch and editing the graph are not counted
+    long long allocations = -1;
+    long long snapshot_pages = 0; // Snapshot pages the batch changed (most on any rank)
+    long long customized = 0;     // Hierarchy arcs re-customized (use_cch), or -1 if it was rebuilt
+};
+
+// In-process dynamic SSSP engine. Graph, partition and shortest-path tree
+// stay in memory between calls, so a batch only pays for its own repair.
+//
+// loadGraph, buildGraph, setSource and applyBatch are collective over the
+// communicator; graph edges and update batches only need to be supplied on
+// rank 0. Queries are local and cheap. With use_openmp the constructor is
+// collective too, since it reports thread placement.
+//
+// The query methods belong to the thread that applies batches. Other
+// threads take a snapshot() instead, which stays consistent while the next
+// batch runs; it holds the version published by the last completed call.
+class DynamicSSSP
+{
+public:
+    DynamicSSSP(MPI_Comm comm = MPI_COMM_WORLD, const DynamicSSSPOptions &options = DynamicSSSPOptions());
+    ~DynamicSSSP();
+    DynamicSSSP(const DynamicSSSP &) = delete;
+    DynamicSSSP &operator=(const DynamicSSSP &) = delete;
+
+    bool loadGraph(const std::string &filename);
+    bool buildGraph(vertex_t V, const std::vector<Edge> &edges);
+    void saveGraph(const std::string &filename);
+    bool setSource(vertex_t source);
+    BatchStats applyBatch(const std::vector<Edge> &updates);
+
+    float distance(vertex_t v) const;
+    vertex_t parentOf(vertex_t v) const;
+    int hopsTo(vertex_t v) const;
+    std::vector<vertex_t> pathTo(vertex_t v) const;
+    // Deepest vertex on both tree paths, -1 if either is unreachable
+    vertex_t commonAncestor(vertex_t u, vertex_t v) const;
+    const std::vector<float> &distances() const;
+    SnapshotStore::View snapshot() const;
+    // Distances from any vertex to a few targets, by A* over the landmark
+    // bounds or from the hierarchy with use_cch. Collective; every rank
+    // passes the same arguments.
+    TargetQuery queryTargets(vertex_t from, const std::vector<vertex_t> &targets);
+
+    // Read-only: the options the engine was built with, its communicator
+    // and this rank's partition of the graph (for statistics and output)
+    const DynamicSSSPOptions &settings() const { return options; }
+    MPI_Comm communicator() const { return comm; }
+    const Graph &localGraph() const { return graph; }
+
+private:
+    MPI_Comm comm;
+    int rank, size;
+    DynamicSSSPOptions options;
+    MPI_Datatype edge_type;
+
+    Graph graph;
+    SSSP sssp;
+    vertex_t source = -1;
+
+    // Query view: owner values gathered after every batch
+    std::vector<float> result_dist;
+    std::vector<vertex_t> result_parent;
+    TreeIndex tree;
+    SnapshotStore snapshots;
+    Landmarks alt;
+    ContractionHierarchy cch;
+
+    bool distributeFromRoot();
+    void finishGraph();
+    void buildHierarchy();
+    void solveOnHierarchy();
+    void solveFromScratch(bool use_device);
+    void publishResults(bool rebuild_tree);
+};
+
+#endif // DYNAMIC_SSSP_H
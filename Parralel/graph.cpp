@@ -5,18 +5,140 @@
 #include <iostream>
 #include <metis.h>
 #include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include "mpi_chunked.h"
+
+#ifdef SSSP_64BIT_IDS
+static const char GRAPH_MAGIC[8] = {'S', 'S', 'S', 'P', 'G', 'R', '6', '4'};
+#else
+static const char GRAPH_MAGIC[8] = {'S', 'S', 'S', 'P', 'G', 'R', 'P', 'H'};
+#endif
+
+MPI_Datatype createEdgeType()
+{
+    MPI_Datatype edge_type;
+    int blocklengths[3] = {1, 1, 1};
+    MPI_Aint offsets[3];
+    MPI_Datatype types[3] = {MPI_VERTEX_T, MPI_VERTEX_T, MPI_FLOAT};
+
+    Edge temp{};
+    MPI_Aint base_address;
+    MPI_Get_address(&temp, &base_address);
+    MPI_Get_address(&temp.u, &offsets[0]);
+    MPI_Get_address(&temp.v, &offsets[1]);
+    MPI_Get_address(&temp.weight, &offsets[2]);
+    offsets[0] = MPI_Aint_diff(offsets[0], base_address);
+    offsets[1] = MPI_Aint_diff(offsets[1], base_address);
+    offsets[2] = MPI_Aint_diff(offsets[2], base_address);
+
+    // Resized to sizeof(Edge) so arrays stride correctly when 64-bit IDs pad the struct
+    MPI_Datatype packed;
+    MPI_Type_create_struct(3, blocklengths, offsets, types, &packed);
+    MPI_Type_create_resized(packed, 0, sizeof(Edge), &edge_type);
+    MPI_Type_free(&packed);
+    MPI_Type_commit(&edge_type);
+    return edge_type;
+}
 
 Graph::Graph() : V(0), E(0) {}
 
+// Edges of a binary graph file, read after its header, with the same checks
+// as the text loader
+static bool loadBinaryEdges(std::ifstream &file, const GraphFileHeader &header, const std::string &filename,
+                            std::vector<Edge> &edges)
+{
+    if (std::memcmp(header.magic, GRAPH_MAGIC, sizeof(GRAPH_MAGIC)) != 0)
+    {
+        std::cerr << "Error: " << filename << " was written with a different vertex ID width" << std::endl;
+        return false;
+    }
+    if (header.num_vertices == 0 || header.num_edges == 0)
+    {
+        std::cerr << "Invalid graph size: V=" << header.num_vertices << ", E=" << header.num_edges << std::endl;
+        return false;
+    }
+    if (header.num_vertices > static_cast<uint64_t>(std::numeric_limits<vertex_t>::max()))
+    {
+        std::cerr << "Error: " << header.num_vertices << " vertices need a build with -DSSSP_64BIT_IDS" << std::endl;
+        return false;
+    }
+
+    vertex_t V = static_cast<vertex_t>(header.num_vertices);
+    const size_t CHUNK = 1 << 16;
+    std::vector<Edge> raw(CHUNK);
+    edges.reserve(header.num_edges);
+    for (uint64_t done = 0; done < header.num_edges;)
+    {
+        size_t n = std::min<uint64_t>(CHUNK, header.num_edges - done);
+        file.read(reinterpret_cast<char *>(raw.data()), n * sizeof(Edge));
+        n = file.gcount() / sizeof(Edge);
+        if (n == 0)
+            break;
+        done += n;
+        for (size_t i = 0; i < n; i++)
+        {
+            const Edge &e = raw[i];
+            if (e.u < 0 || e.u >= V || e.v < 0 || e.v >= V)
+            {
+                std::cerr << "Invalid vertex indices in edge: " << e.u << " " << e.v << std::endl;
+                continue;
+            }
+            if (e.u == e.v)
+            {
+                std::cerr << "Warning: Self-loop found at vertex " << e.u << ", ignoring" << std::endl;
+                continue;
+            }
+            if (e.weight < 0)
+            {
+                std::cerr << "Warning: Negative weight found in edge " << e.u << "-" << e.v
+                          << ", Dijkstra's algorithm may not work correctly" << std::endl;
+            }
+            edges.push_back(e);
+        }
+    }
+    if (edges.size() < header.num_edges)
+        std::cerr << "Warning: Expected " << header.num_edges << " edges but found only " << edges.size() << std::endl;
+    return true;
+}
+
 void Graph::loadFromFile(const std::string &filename)
 {
-    std::ifstream file(filename);
+    std::ifstream file(filename, std::ios::binary);
     if (!file.is_open())
     {
         std::cerr << "Error opening file: " << filename << std::endl;
         return;
     }
 
+    // Binary files written by saveBinary start with the magic; anything
+    // else is read as text from the start again
+    GraphFileHeader bin;
+    if (file.read(reinterpret_cast<char *>(&bin), sizeof(bin)) &&
+        std::memcmp(bin.magic, GRAPH_MAGIC, 6) == 0)
+    {
+        adj.clear();
+        edges.clear();
+        V = 0;
+        E = 0;
+        if (!loadBinaryEdges(file, bin, filename, edges))
+            return;
+        V = static_cast<vertex_t>(bin.num_vertices);
+        E = edges.size();
+        adj.resize(V);
+        for (const Edge &e : edges)
+        {
+            adj[e.u].emplace_back(e.v, e.weight);
+            adj[e.v].emplace_back(e.u, e.weight);
+        }
+        std::cout << "Successfully loaded graph with " << V << " vertices and " << E << " edges" << std::endl;
+        return;
+    }
+    file.clear();
+    file.seekg(0);
+
     if (!(file >> V >> E))
     {
         std::cerr << "Error reading graph header" << std::endl;
@@ -36,9 +158,9 @@ void Graph::loadFromFile(const std::string &filename)
     edges.clear();
     edges.reserve(E);
 
-    int u, v;
+    vertex_t u, v;
     float weight;
-    int edge_count = 0;
+    edge_t edge_count = 0;
     std::string line;
 
     std::getline(file, line);
@@ -117,6 +239,372 @@ void Graph::loadFromFile(const std::string &filename)
     std::cout << "Successfully loaded graph with " << V << " vertices and " << E << " edges" << std::endl;
 }
 
+// Reads [offset, offset + count) in pieces that fit an MPI count
+static void readAt(MPI_File fh, MPI_Offset offset, char *buf, MPI_Offset count)
+{
+    const MPI_Offset PIECE = 1 << 30;
+    while (count > 0)
+    {
+        int n = static_cast<int>(std::min(count, PIECE));
+        MPI_File_read_at(fh, offset, buf, n, MPI_CHAR, MPI_STATUS_IGNORE);
+        offset += n;
+        buf += n;
+        count -= n;
+    }
+}
+
+// Parses "u v w" from one line; returns false on malformed input
+static bool parseEdgeLine(const char *p, const char *end, vertex_t &u, vertex_t &v, float &weight)
+{
+    auto skip = [&]()
+    {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+            p++;
+    };
+
+    skip();
+    auto r = std::from_chars(p, end, u);
+    if (r.ec != std::errc())
+        return false;
+    p = r.ptr;
+    skip();
+    r = std::from_chars(p, end, v);
+    if (r.ec != std::errc())
+        return false;
+    p = r.ptr;
+    skip();
+    if (p < end && *p == '+')
+        p++;
+    auto rf = std::from_chars(p, end, weight);
+    return rf.ec == std::errc();
+}
+
+void Graph::loadFromFileParallel(const std::string &filename, MPI_Comm comm, MPI_Datatype edge_type)
+{
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    V = 0;
+    E = 0;
+    adj.clear();
+    edges.clear();
+
+    MPI_File fh;
+    if (MPI_File_open(comm, filename.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS)
+    {
+        if (rank == 0)
+            std::cerr << "Error opening file: " << filename << std::endl;
+        return;
+    }
+
+    MPI_Offset file_size;
+    MPI_File_get_size(fh, &file_size);
+
+    // Rank 0 decodes the header: V, E, offset of the edge data, binary flag
+    long long header[4] = {0, 0, 0, 0};
+    if (rank == 0)
+    {
+        char head[256] = {};
+        MPI_Offset head_size = std::min<MPI_Offset>(file_size, sizeof(head));
+        readAt(fh, 0, head, head_size);
+
+        GraphFileHeader bin;
+        if (head_size >= static_cast<MPI_Offset>(sizeof(bin)) &&
+            std::memcmp(head, GRAPH_MAGIC, 6) == 0 && std::memcmp(head, GRAPH_MAGIC, 8) != 0)
+        {
+            std::cerr << "Error: " << filename << " was written with a different vertex ID width" << std::endl;
+        }
+        else if (head_size >= static_cast<MPI_Offset>(sizeof(bin)) &&
+                 std::memcmp(head, GRAPH_MAGIC, sizeof(GRAPH_MAGIC)) == 0)
+        {
+            std::memcpy(&bin, head, sizeof(bin));
+            header[0] = bin.num_vertices;
+            header[1] = bin.num_edges;
+            header[2] = sizeof(bin);
+            header[3] = 1;
+        }
+        else
+        {
+            const char *line_end = static_cast<const char *>(std::memchr(head, '\n', head_size));
+            long long hv = 0, he = 0;
+            const char *p = head;
+            auto r = std::from_chars(p, head + head_size, hv);
+            if (r.ec == std::errc())
+            {
+                p = r.ptr;
+                while (p < head + head_size && (*p == ' ' || *p == '\t'))
+                    p++;
+                r = std::from_chars(p, head + head_size, he);
+            }
+            if (r.ec != std::errc() || !line_end)
+            {
+                std::cerr << "Error reading graph header" << std::endl;
+            }
+            else
+            {
+                header[0] = hv;
+                header[1] = he;
+                header[2] = line_end - head + 1;
+            }
+        }
+    }
+    MPI_Bcast(header, 4, MPI_LONG_LONG, 0, comm);
+
+    if (header[0] <= 0 || header[1] <= 0)
+    {
+        if (rank == 0)
+            std::cerr << "Invalid graph size: V=" << header[0] << ", E=" << header[1] << std::endl;
+        MPI_File_close(&fh);
+        return;
+    }
+
+    if (header[0] > std::numeric_limits<vertex_t>::max())
+    {
+        if (rank == 0)
+            std::cerr << "Error: " << header[0] << " vertices need a build with -DSSSP_64BIT_IDS" << std::endl;
+        MPI_File_close(&fh);
+        return;
+    }
+
+    vertex_t num_vertices = header[0];
+    MPI_Offset data_offset = header[2];
+    bool binary = header[3] != 0;
+    std::vector<Edge> parsed;
+
+    auto accept = [&](vertex_t u, vertex_t v, float weight)
+    {
+        if (u < 0 || u >= num_vertices || v < 0 || v >= num_vertices)
+        {
+            std::cerr << "Invalid vertex indices in edge: " << u << " " << v << std::endl;
+            return;
+        }
+        if (u == v)
+        {
+            std::cerr << "Warning: Self-loop found at vertex " << u << ", ignoring" << std::endl;
+            return;
+        }
+        if (weight < 0)
+        {
+            std::cerr << "Warning: Negative weight found in edge " << u << "-" << v
+                      << ", Dijkstra's algorithm may not work correctly" << std::endl;
+        }
+        parsed.push_back({u, v, weight});
+    };
+
+    if (binary)
+    {
+        // Fixed-size records: split the record range evenly
+        MPI_Offset records = (file_size - data_offset) / sizeof(Edge);
+        records = std::min<MPI_Offset>(records, header[1]);
+        MPI_Offset first = records * rank / size;
+        MPI_Offset last = records * (rank + 1) / size;
+
+        std::vector<Edge> raw(last - first);
+        readAt(fh, data_offset + first * sizeof(Edge), reinterpret_cast<char *>(raw.data()),
+               (last - first) * sizeof(Edge));
+        parsed.reserve(raw.size());
+        for (const auto &e : raw)
+            accept(e.u, e.v, e.weight);
+    }
+    else
+    {
+        // Each rank owns the lines that start inside its byte range. Read one
+        // byte before the range to find the first line start, and keep
+        // reading past the end until the last line is complete.
+        MPI_Offset data_size = file_size - data_offset;
+        MPI_Offset begin = data_offset + data_size * rank / size;
+        MPI_Offset end = data_offset + data_size * (rank + 1) / size;
+        MPI_Offset read_begin = (begin > data_offset) ? begin - 1 : begin;
+
+        std::vector<char> buf(end - read_begin);
+        readAt(fh, read_begin, buf.data(), buf.size());
+        MPI_Offset read_end = end;
+        MPI_Offset scan_from = std::max(begin, end - 1) - read_begin;
+        const MPI_Offset EXTRA = 1 << 16;
+        while (read_end < file_size &&
+               std::find(buf.begin() + scan_from, buf.end(), '\n') == buf.end())
+        {
+            MPI_Offset n = std::min(EXTRA, file_size - read_end);
+            buf.resize(buf.size() + n);
+            readAt(fh, read_end, buf.data() + (read_end - read_begin), n);
+            read_end += n;
+        }
+
+        const char *p = buf.data();
+        const char *buf_end = buf.data() + buf.size();
+        const char *range_end = buf.data() + (end - read_begin);
+        if (read_begin < begin)
+        {
+            p = static_cast<const char *>(std::memchr(p, '\n', buf_end - p));
+            p = p ? p + 1 : buf_end;
+        }
+
+        vertex_t u, v;
+        float weight;
+        while (p < range_end)
+        {
+            const char *line_end = static_cast<const char *>(std::memchr(p, '\n', buf_end - p));
+            if (!line_end)
+                line_end = buf_end;
+
+            if (line_end > p && *p != '#' && !(line_end - p == 1 && *p == '\r'))
+            {
+                if (parseEdgeLine(p, line_end, u, v, weight))
+                    accept(u, v, weight);
+                else
+                    std::cerr << "Error parsing edge line: " << std::string(p, line_end) << std::endl;
+            }
+            p = line_end + 1;
+        }
+    }
+    MPI_File_close(&fh);
+
+    V = num_vertices;
+    long long local_edges = parsed.size(), total_edges = 0;
+    MPI_Allreduce(&local_edges, &total_edges, 1, MPI_LONG_LONG, MPI_SUM, comm);
+    E = total_edges;
+    if (rank == 0 && total_edges < header[1])
+    {
+        std::cerr << "Warning: Expected " << header[1] << " edges but found only " << total_edges << std::endl;
+    }
+
+    // Nothing is gathered to partition: every rank sums the degrees of its
+    // edges, and the vertex IDs are cut into contiguous ranges of about equal
+    // degree (plus one per vertex). Each rank computes the same ranges, so
+    // this relies on the file's numbering for locality where METIS would
+    // find a cut on its own.
+    part.assign(V, 0);
+    if (size > 1)
+    {
+        std::vector<int64_t> load(V, 1);
+        for (const auto &e : parsed)
+        {
+            load[e.u]++;
+            load[e.v]++;
+        }
+        allreduceChunked(MPI_IN_PLACE, load.data(), V, MPI_INT64_T, MPI_SUM, comm);
+
+        int64_t total = static_cast<int64_t>(V) + 2 * total_edges, before = 0;
+        for (vertex_t v = 0; v < V; v++)
+        {
+            part[v] = static_cast<int>(std::min<int64_t>(size - 1, before * size / total));
+            before += load[v];
+        }
+    }
+
+    // Shuffle every edge to the owners of its endpoints
+    std::vector<int64_t> send_counts(size, 0), recv_counts(size), send_displs(size, 0);
+    for (const auto &e : parsed)
+    {
+        send_counts[part[e.u]]++;
+        if (part[e.v] != part[e.u])
+            send_counts[part[e.v]]++;
+    }
+    for (int r = 1; r < size; r++)
+        send_displs[r] = send_displs[r - 1] + send_counts[r - 1];
+
+    std::vector<Edge> outgoing(send_displs[size - 1] + send_counts[size - 1]);
+    std::vector<int64_t> fill(send_displs);
+    for (const auto &e : parsed)
+    {
+        outgoing[fill[part[e.u]]++] = e;
+        if (part[e.v] != part[e.u])
+            outgoing[fill[part[e.v]]++] = e;
+    }
+    parsed = std::vector<Edge>();
+
+    MPI_Alltoall(send_counts.data(), 1, MPI_INT64_T, recv_counts.data(), 1, MPI_INT64_T, comm);
+    int64_t incoming = 0;
+    for (int64_t c : recv_counts)
+        incoming += c;
+    edges.resize(incoming);
+    alltoallvChunked(outgoing.data(), send_counts, edges.data(), recv_counts, edge_type, comm);
+
+    adj.resize(V);
+    for (const auto &e : edges)
+    {
+        adj[e.u].emplace_back(e.v, e.weight);
+        adj[e.v].emplace_back(e.u, e.weight);
+    }
+
+    if (rank == 0)
+    {
+        std::cout << "Successfully loaded graph with " << V << " vertices and " << E << " edges" << std::endl;
+    }
+}
+
+void Graph::saveBinary(const std::string &filename, MPI_Comm comm)
+{
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    // Each edge is written once, by the owner of its lower endpoint
+    std::vector<Edge> mine;
+    for (vertex_t u = 0; u < V; u++)
+    {
+        if (!part.empty() && part[u] != rank)
+            continue;
+        forEachNeighbor(u, [&](vertex_t v, float weight)
+                        {
+                            if (u < v)
+                                mine.push_back({u, v, weight}); });
+    }
+
+    long long count = mine.size(), before = 0, total = 0;
+    MPI_Exscan(&count, &before, 1, MPI_LONG_LONG, MPI_SUM, comm);
+    MPI_Allreduce(&count, &total, 1, MPI_LONG_LONG, MPI_SUM, comm);
+    if (rank == 0)
+        before = 0;
+
+    MPI_File fh;
+    if (MPI_File_open(comm, filename.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                      MPI_INFO_NULL, &fh) != MPI_SUCCESS)
+    {
+        if (rank == 0)
+            std::cerr << "Error opening output file: " << filename << std::endl;
+        return;
+    }
+    MPI_File_set_size(fh, 0);
+
+    GraphFileHeader header;
+    std::memcpy(header.magic, GRAPH_MAGIC, sizeof(GRAPH_MAGIC));
+    header.num_vertices = V;
+    header.num_edges = total;
+    if (rank == 0)
+        MPI_File_write_at(fh, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE);
+
+    // Raw records, padding included, so the loader can read them back as Edge
+    writeAtAllChunked(fh, sizeof(header) + before * sizeof(Edge), mine.data(),
+                      mine.size() * sizeof(Edge), MPI_BYTE, comm);
+    MPI_File_close(&fh);
+}
+
+// The adjacency as METIS takes it, or false if idx_t cannot index it
+static bool metisAdjacency(const Graph &graph, std::vector<idx_t> &xadj, std::vector<idx_t> &adjncy)
+{
+    // Size the CSR from the actual degrees; E can drift from the adjacency
+    // after updates, and 2 * E overflowed int on large graphs
+    edge_t entries = 0;
+    for (vertex_t v = 0; v < graph.V; v++)
+        entries += graph.degree(v);
+    if (static_cast<uint64_t>(entries) > static_cast<uint64_t>(std::numeric_limits<idx_t>::max()))
+    {
+        std::cerr << "Graph has " << entries << " adjacency entries, more than METIS idx_t holds" << std::endl;
+        return false;
+    }
+
+    xadj.assign(graph.V + 1, 0);
+    adjncy.resize(entries);
+    for (vertex_t i = 0; i < graph.V; i++)
+    {
+        xadj[i + 1] = xadj[i];
+        graph.forEachNeighbor(i, [&](vertex_t v, float)
+                              { adjncy[xadj[i + 1]++] = v; });
+    }
+    return true;
+}
+
 void Graph::partitionGraph(int num_parts)
 {
     if (V == 0)
@@ -127,25 +615,23 @@ void Graph::partitionGraph(int num_parts)
         num_parts = V;
     }
 
+    part.resize(V);
+    std::vector<idx_t> xadj, adjncy;
+    if (!metisAdjacency(*this, xadj, adjncy))
+    {
+        std::cerr << "Using simple vertex partitioning instead" << std::endl;
+        for (vertex_t v = 0; v < V; v++)
+            part[v] = v % num_parts;
+        return;
+    }
+
     idx_t nvtxs = V;
     idx_t ncon = 1;
-    idx_t *xadj = new idx_t[V + 1];
-    idx_t *adjncy = new idx_t[2 * E];
+    std::vector<idx_t> part_idx(V);
     idx_t *vwgt = nullptr;
     idx_t *adjwgt = nullptr;
     idx_t objval;
     idx_t nparts = num_parts;
-    part.resize(V);
-
-    xadj[0] = 0;
-    for (int i = 0; i < V; i++)
-    {
-        xadj[i + 1] = xadj[i] + adj[i].size();
-        for (size_t j = 0; j < adj[i].size(); j++)
-        {
-            adjncy[xadj[i] + j] = adj[i][j].first;
-        }
-    }
 
     idx_t options[METIS_NOPTIONS];
     METIS_SetDefaultOptions(options);
@@ -154,9 +640,11 @@ void Graph::partitionGraph(int num_parts)
     // Remove the contiguity constraint since the graph might not be contiguous
     // options[METIS_OPTION_CONTIG] = 1;  // This was causing the error
     
-    int ret = METIS_PartGraphKway(&nvtxs, &ncon, xadj, adjncy, vwgt, nullptr,
+    int ret = METIS_PartGraphKway(&nvtxs, &ncon, xadj.data(), adjncy.data(), vwgt, nullptr,
                                   adjwgt, &nparts, nullptr, nullptr, options,
-                                  &objval, part.data());
+                                  &objval, part_idx.data());
+    for (vertex_t v = 0; v < V; v++)
+        part[v] = part_idx[v];
 
     if (ret != METIS_OK)
     {
@@ -171,7 +659,7 @@ void Graph::partitionGraph(int num_parts)
             std::cerr << "General METIS error" << std::endl;
             
         std::cerr << "Using simple vertex partitioning instead" << std::endl;
-        for (int v = 0; v < V; v++)
+        for (vertex_t v = 0; v < V; v++)
         {
             part[v] = v % num_parts;
         }
@@ -182,7 +670,7 @@ void Graph::partitionGraph(int num_parts)
         
         // Optionally, print partition statistics
         std::vector<int> part_sizes(num_parts, 0);
-        for (int v = 0; v < V; v++)
+        for (vertex_t v = 0; v < V; v++)
         {
             if (part[v] >= 0 && part[v] < num_parts)
                 part_sizes[part[v]]++;
@@ -198,9 +686,41 @@ void Graph::partitionGraph(int num_parts)
         std::cout << std::endl;
     }
 
-    delete[] xadj;
-    delete[] adjncy;
 }
+// Elimination order for a contraction hierarchy: METIS nested dissection,
+// which numbers separators last, so order[v] is v's position. Falls back to
+// ascending degree, a crude minimum-degree order, if METIS cannot run.
+std::vector<vertex_t> Graph::nestedDissectionOrder() const
+{
+    std::vector<vertex_t> order(V);
+    std::vector<idx_t> xadj, adjncy;
+    if (metisAdjacency(*this, xadj, adjncy))
+    {
+        idx_t nvtxs = V;
+        std::vector<idx_t> perm(V), iperm(V);
+        idx_t options[METIS_NOPTIONS];
+        METIS_SetDefaultOptions(options);
+        int ret = METIS_NodeND(&nvtxs, xadj.data(), adjncy.data(), nullptr, options, perm.data(), iperm.data());
+        if (ret == METIS_OK)
+        {
+            for (vertex_t v = 0; v < V; v++)
+                order[v] = iperm[v];
+            return order;
+        }
+        std::cerr << "METIS nested dissection failed with code " << ret << std::endl;
+    }
+
+    std::cerr << "Ordering vertices by degree instead" << std::endl;
+    std::vector<vertex_t> by_degree(V);
+    for (vertex_t v = 0; v < V; v++)
+        by_degree[v] = v;
+    std::stable_sort(by_degree.begin(), by_degree.end(), [&](vertex_t a, vertex_t b)
+                     { return degree(a) < degree(b); });
+    for (vertex_t i = 0; i < V; i++)
+        order[by_degree[i]] = i;
+    return order;
+}
+
 void Graph::distributeGraph(MPI_Comm comm)
 {
     int rank, size;
@@ -210,7 +730,7 @@ void Graph::distributeGraph(MPI_Comm comm)
     local_vertices.clear();
     ghost_vertices.clear();
 
-    for (int v = 0; v < V; v++)
+    for (vertex_t v = 0; v < V; v++)
     {
         if (part[v] == rank)
         {
@@ -218,21 +738,20 @@ void Graph::distributeGraph(MPI_Comm comm)
         }
     }
 
-    for (int v : local_vertices)
+    std::vector<char> seen(V, 0);
+    for (vertex_t v : local_vertices)
     {
-        for (const auto &neighbor : adj[v])
-        {
-            int u = neighbor.first;
-            if (part[u] != rank &&
-                std::find(ghost_vertices.begin(), ghost_vertices.end(), u) == ghost_vertices.end())
-            {
-                ghost_vertices.push_back(u);
-            }
-        }
+        forEachNeighbor(v, [&](vertex_t u, float)
+                        {
+                            if (part[u] != rank && !seen[u])
+                            {
+                                seen[u] = 1;
+                                ghost_vertices.push_back(u);
+                            } });
     }
 }
 
-void Graph::addEdge(int u, int v, float weight)
+void Graph::addEdge(vertex_t u, vertex_t v, float weight)
 {
     if (u < 0 || u >= V || v < 0 || v >= V)
     {
@@ -240,6 +759,19 @@ void Graph::addEdge(int u, int v, float weight)
         return;
     }
 
+    if (compressed)
+    {
+        std::vector<std::pair<vertex_t, float>> list;
+        cadj.decode(u, list);
+        list.emplace_back(v, weight);
+        cadj.setNeighbors(u, list);
+        cadj.decode(v, list);
+        list.emplace_back(u, weight);
+        cadj.setNeighbors(v, list);
+        E++;
+        return;
+    }
+
     edges.push_back({u, v, weight});
     adj[u].emplace_back(v, weight);
     adj[v].emplace_back(u, weight);
@@ -248,6 +780,12 @@ void Graph::addEdge(int u, int v, float weight)
 
 void Graph::applyUpdates(const std::vector<Edge> &updates)
 {
+    if (compressed)
+    {
+        applyUpdatesCompressed(updates);
+        return;
+    }
+
     for (const auto &edge : updates)
     {
         if (edge.weight < 0) // Handle deletion
@@ -255,7 +793,7 @@ void Graph::applyUpdates(const std::vector<Edge> &updates)
             // Remove edge from adj[edge.u]
             adj[edge.u].erase(
                 std::remove_if(adj[edge.u].begin(), adj[edge.u].end(),
-                               [edge](const std::pair<int, float> &neighbor)
+                               [edge](const std::pair<vertex_t, float> &neighbor)
                                {
                                    return neighbor.first == edge.v;
                                }),
@@ -263,7 +801,7 @@ void Graph::applyUpdates(const std::vector<Edge> &updates)
             // Remove edge from adj[edge.v]
             adj[edge.v].erase(
                 std::remove_if(adj[edge.v].begin(), adj[edge.v].end(),
-                               [edge](const std::pair<int, float> &neighbor)
+                               [edge](const std::pair<vertex_t, float> &neighbor)
                                {
                                    return neighbor.first == edge.u;
                                }),
@@ -306,15 +844,131 @@ void Graph::gatherSSSPResults(MPI_Comm comm, std::vector<float> &global_dist)
     MPI_Comm_rank(comm, &rank);
     MPI_Comm_size(comm, &size);
 
-    std::vector<float> local_dists = global_dist;
-    std::vector<float> all_dists(V);
-
-    MPI_Allreduce(local_dists.data(), all_dists.data(), V, MPI_FLOAT, MPI_MIN, comm);
+    // Only the owner's copy of a distance is authoritative; everything else
+    // may be a stale ghost value. The ghosts are overwritten by the reduction
+    // anyway, so it runs in place.
+    if (!part.empty())
+    {
+        for (vertex_t v = 0; v < V; v++)
+        {
+            if (part[v] != rank)
+                global_dist[v] = std::numeric_limits<float>::infinity();
+        }
+    }
 
-    global_dist = all_dists;
+    allreduceChunked(MPI_IN_PLACE, global_dist.data(), V, MPI_FLOAT, MPI_MIN, comm);
 
     if (rank == 0)
     {
         std::cout << "Gathered SSSP results from all processes" << std::endl;
     }
-}
\ No newline at end of file
+}
+
+void Graph::applyUpdatesCompressed(const std::vector<Edge> &updates)
+{
+    // Same semantics as the adjacency-list path, but each touched list is
+    // decoded once and re-encoded once per batch
+    std::unordered_map<vertex_t, std::vector<std::pair<vertex_t, float>>> touched;
+    auto list_of = [&](vertex_t v) -> std::vector<std::pair<vertex_t, float>> &
+    {
+        auto it = touched.find(v);
+        if (it == touched.end())
+        {
+            it = touched.emplace(v, std::vector<std::pair<vertex_t, float>>()).first;
+            cadj.decode(v, it->second);
+        }
+        return it->second;
+    };
+
+    for (const auto &edge : updates)
+    {
+        auto &list_u = list_of(edge.u);
+        auto &list_v = list_of(edge.v);
+        if (edge.weight < 0)
+        {
+            list_u.erase(std::remove_if(list_u.begin(), list_u.end(),
+                                        [&](const std::pair<vertex_t, float> &n)
+                                        { return n.first == edge.v; }),
+                         list_u.end());
+            list_v.erase(std::remove_if(list_v.begin(), list_v.end(),
+                                        [&](const std::pair<vertex_t, float> &n)
+                                        { return n.first == edge.u; }),
+                         list_v.end());
+            E--;
+        }
+        else
+        {
+            bool found = false;
+            for (auto *list : {&list_u, &list_v})
+            {
+                vertex_t other = (list == &list_u) ? edge.v : edge.u;
+                for (auto &neighbor : *list)
+                {
+                    if (neighbor.first == other)
+                    {
+                        neighbor.second = edge.weight;
+                        found = true;
+                        break;
+                    }
+                }
+            }
+            if (!found)
+            {
+                list_u.emplace_back(edge.v, edge.weight);
+                list_v.emplace_back(edge.u, edge.weight);
+                E++;
+            }
+        }
+    }
+
+    for (auto &entry : touched)
+        cadj.setNeighbors(entry.first, entry.second);
+}
+
+// Re-allocates every adjacency list from a thread of the OpenMP team, in
+// the same static split over vertex IDs as SSSP's per-vertex arrays, so the
+// lists are spread over the NUMA nodes instead of sitting on rank 0's loader
+// thread's node
+void Graph::placeAdjacency()
+{
+#pragma omp parallel for schedule(static)
+    for (vertex_t v = 0; v < V; v++)
+    {
+        if (!adj[v].empty())
+            std::vector<std::pair<vertex_t, float>>(adj[v].begin(), adj[v].end()).swap(adj[v]);
+    }
+}
+
+uint64_t Graph::compress()
+{
+    // Returns the bytes held by adj and edges before they were released
+    if (compressed)
+        return 0;
+
+    uint64_t before = edges.capacity() * sizeof(Edge) + adj.capacity() * sizeof(adj[0]);
+    for (const auto &list : adj)
+        before += list.capacity() * sizeof(list[0]);
+
+    cadj.build(adj);
+    compressed = true;
+    std::vector<std::vector<std::pair<vertex_t, float>>>().swap(adj);
+    std::vector<Edge>().swap(edges);
+    return before;
+}
+
+edge_t Graph::degree(vertex_t v) const
+{
+    return compressed ? cadj.degrees[v] : adj[v].size();
+}
+
+float Graph::edgeWeight(vertex_t u, vertex_t v) const
+{
+    if (compressed)
+        return cadj.find(u, v);
+    for (const auto &neighbor : adj[u])
+    {
+        if (neighbor.first == v)
+            return neighbor.second;
+    }
+    return -1.0f;
+}
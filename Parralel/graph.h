@@ -3,33 +3,93 @@
 
 #include <vector>
 #include <string>
+#include <cstdint>
 #include <mpi.h>
+#include "sssp_types.h"
+#include "compressed_adjacency.h"
 
 struct Edge
 {
-    int u, v;
+    vertex_t u, v;
     float weight;
 };
 
+// Header of the binary graph file, followed by num_edges raw Edge records.
+// The magic records the ID width the file was written with.
+struct GraphFileHeader
+{
+    char magic[8]; // "SSSPGRPH" (32-bit IDs) or "SSSPGR64"
+    uint64_t num_vertices;
+    uint64_t num_edges;
+};
+
+MPI_Datatype createEdgeType();
+
 class Graph
 {
 public:
-    int V, E;
+    vertex_t V;
+    edge_t E;
     std::vector<Edge> edges;
-    std::vector<std::vector<std::pair<int, float>>> adj;
+    std::vector<std::vector<std::pair<vertex_t, float>>> adj;
+
+    // Optional compact storage; replaces adj and edges once compress() ran
+    bool compressed = false;
+    CompressedAdjacency cadj;
 
     // Partitioning information
     std::vector<int> part;
-    std::vector<int> local_vertices;
-    std::vector<int> ghost_vertices;
+    std::vector<vertex_t> local_vertices;
+    std::vector<vertex_t> ghost_vertices;
 
     Graph();
     void loadFromFile(const std::string &filename);
+    void loadFromFileParallel(const std::string &filename, MPI_Comm comm, MPI_Datatype edge_type);
+    void saveBinary(const std::string &filename, MPI_Comm comm);
     void partitionGraph(int num_parts);
+    std::vector<vertex_t> nestedDissectionOrder() const;
     void distributeGraph(MPI_Comm comm);
-    void addEdge(int u, int v, float weight);
+    void placeAdjacency();
+    void addEdge(vertex_t u, vertex_t v, float weight);
     void applyUpdates(const std::vector<Edge> &updates);
+    void applyUpdatesCompressed(const std::vector<Edge> &updates);
     void gatherSSSPResults(MPI_Comm comm, std::vector<float> &global_dist);
+    uint64_t compress();
+    edge_t degree(vertex_t v) const;
+    float edgeWeight(vertex_t u, vertex_t v) const;
+
+    // Calls f(neighbor, weight) for every edge of v in either representation
+    template <typename F>
+    void forEachNeighbor(vertex_t v, F &&f) const
+    {
+        if (compressed)
+        {
+            cadj.forEach(v, f);
+            return;
+        }
+        for (const auto &neighbor : adj[v])
+            f(neighbor.first, neighbor.second);
+    }
+
+    // Same for the slice [begin, end) of v's neighbour list. Compressed
+    // lists are decoded from the start, so only split uncompressed ones.
+    template <typename F>
+    void forEachNeighborInRange(vertex_t v, edge_t begin, edge_t end, F &&f) const
+    {
+        if (compressed)
+        {
+            edge_t i = 0;
+            cadj.forEach(v, [&](vertex_t u, float weight)
+                         {
+                             if (i >= begin && i < end)
+                                 f(u, weight);
+                             i++; });
+            return;
+        }
+        const auto &list = adj[v];
+        for (edge_t i = begin; i < end; i++)
+            f(list[i].first, list[i].second);
+    }
 };
 
 #endif // GRAPH_H
\ No newline at end of file
@@ -0,0 +1,302 @@
+#include "halo_exchange.h"
+#include <algorithm>
+#include <cstddef>
+
+static const int REFRESH_TAG = 27;
+static const int BOUNDARY_TAG = 28;
+
+MPI_Datatype boundaryUpdateType()
+{
+#ifdef SSSP_64BIT_IDS
+    // Committed once and kept for the lifetime of the process
+    static MPI_Datatype type = MPI_DATATYPE_NULL;
+    if (type == MPI_DATATYPE_NULL)
+    {
+        int blocklengths[2] = {1, 1};
+        MPI_Aint offsets[2] = {offsetof(BoundaryUpdate, dist), offsetof(BoundaryUpdate, vertex)};
+        MPI_Datatype types[2] = {MPI_FLOAT, MPI_VERTEX_T};
+        MPI_Datatype packed;
+        MPI_Type_create_struct(2, blocklengths, offsets, types, &packed);
+        MPI_Type_create_resized(packed, 0, sizeof(BoundaryUpdate), &type);
+        MPI_Type_free(&packed);
+        MPI_Type_commit(&type);
+    }
+    return type;
+#else
+    return MPI_FLOAT_INT;
+#endif
+}
+
+HaloExchange::~HaloExchange()
+{
+    if (active)
+    {
+        end();
+    }
+}
+
+// assign() to exactly n leaves no room, so a batch that adds a single
+// boundary slot would reallocate; grow by half again instead
+template <typename T>
+static void assignWithRoom(std::vector<T> &v, size_t n, const T &value)
+{
+    if (n > v.capacity())
+        v.reserve(n + n / 2);
+    v.assign(n, value);
+}
+
+void HaloExchange::setup(const Graph &graph, MPI_Comm comm, int max_in_flight)
+{
+    if (active)
+    {
+        end();
+    }
+
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    this->comm = comm;
+    this->max_in_flight = std::max(1, max_in_flight);
+
+    // Lists are cleared rather than dropped, so a re-setup after an update
+    // batch reuses their storage
+    neighbor_ranks.clear();
+    for (auto &list : send_lists)
+        list.clear();
+    for (auto &list : recv_lists)
+        list.clear();
+
+    rank_index.assign(size, -1);
+    for (vertex_t v : graph.local_vertices)
+    {
+        graph.forEachNeighbor(v, [&](vertex_t u, float)
+                              {
+                                  int owner = graph.part[u];
+                                  if (owner == rank)
+                                      return;
+
+                                  if (rank_index[owner] < 0)
+                                  {
+                                      rank_index[owner] = neighbor_ranks.size();
+                                      neighbor_ranks.push_back(owner);
+                                      if (send_lists.size() < neighbor_ranks.size())
+                                      {
+                                          send_lists.emplace_back();
+                                          recv_lists.emplace_back();
+                                      }
+                                  }
+                                  send_lists[rank_index[owner]].push_back(v);
+                                  recv_lists[rank_index[owner]].push_back(u); });
+    }
+    send_lists.resize(neighbor_ranks.size());
+    recv_lists.resize(neighbor_ranks.size());
+
+    // Both ends derive the same vertex set for a pair, so sorting makes the
+    // lists agree without any extra communication
+    for (size_t n = 0; n < neighbor_ranks.size(); n++)
+    {
+        for (auto *list : {&send_lists[n], &recv_lists[n]})
+        {
+            std::sort(list->begin(), list->end());
+            list->erase(std::unique(list->begin(), list->end()), list->end());
+        }
+    }
+
+    slot_offsets.assign(graph.V + 1, 0);
+    for (const auto &list : send_lists)
+    {
+        for (vertex_t v : list)
+            slot_offsets[v + 1]++;
+    }
+    for (vertex_t v = 0; v < graph.V; v++)
+        slot_offsets[v + 1] += slot_offsets[v];
+
+    assignWithRoom(slot_neighbor, slot_offsets[graph.V], 0);
+    assignWithRoom<vertex_t>(slot_vertex, slot_offsets[graph.V], 0);
+    assignWithRoom<char>(slot_pending, slot_offsets[graph.V], 0);
+    fill.assign(slot_offsets.begin(), slot_offsets.end() - 1);
+    for (size_t n = 0; n < send_lists.size(); n++)
+    {
+        for (vertex_t v : send_lists[n])
+        {
+            slot_neighbor[fill[v]] = n;
+            slot_vertex[fill[v]] = v;
+            fill[v]++;
+        }
+    }
+
+    pending.resize(neighbor_ranks.size());
+    send_bufs.resize(neighbor_ranks.size());
+    send_reqs.resize(neighbor_ranks.size());
+    for (size_t n = 0; n < neighbor_ranks.size(); n++)
+    {
+        pending[n].clear();
+        send_bufs[n].resize(this->max_in_flight);
+        send_reqs[n].assign(this->max_in_flight, MPI_REQUEST_NULL);
+    }
+    recv_bufs.resize(neighbor_ranks.size());
+    recv_total = 0;
+    for (size_t n = 0; n < neighbor_ranks.size(); n++)
+    {
+        recv_bufs[n].resize(recv_lists[n].size());
+        recv_total += recv_lists[n].size();
+    }
+
+    // Sized here so exchangeAll() after the next batch finds them ready
+    out.resize(neighbor_ranks.size());
+    in.resize(neighbor_ranks.size());
+    for (size_t n = 0; n < neighbor_ranks.size(); n++)
+    {
+        out[n].resize(send_lists[n].size());
+        in[n].resize(recv_lists[n].size());
+    }
+    recv_reqs.assign(neighbor_ranks.size(), MPI_REQUEST_NULL);
+}
+
+void HaloExchange::begin(int phase)
+{
+    // A rank may start the next phase before its neighbours have noticed
+    // that the previous one terminated, so each phase gets its own tag
+    tag = BOUNDARY_TAG + phase;
+    for (size_t n = 0; n < neighbor_ranks.size(); n++)
+    {
+        MPI_Irecv(recv_bufs[n].data(), recv_bufs[n].size(), boundaryUpdateType(),
+                  neighbor_ranks[n], tag, comm, &recv_reqs[n]);
+    }
+    active = true;
+}
+
+void HaloExchange::end()
+{
+    for (auto &req : recv_reqs)
+    {
+        if (req != MPI_REQUEST_NULL)
+        {
+            MPI_Cancel(&req);
+            MPI_Wait(&req, MPI_STATUS_IGNORE);
+        }
+    }
+    for (auto &reqs : send_reqs)
+    {
+        MPI_Waitall(reqs.size(), reqs.data(), MPI_STATUSES_IGNORE);
+    }
+    active = false;
+}
+
+void HaloExchange::markChanged(vertex_t v)
+{
+    for (edge_t s = slot_offsets[v]; s < slot_offsets[v + 1]; s++)
+    {
+        if (!slot_pending[s])
+        {
+            slot_pending[s] = 1;
+            pending[slot_neighbor[s]].push_back(s);
+        }
+    }
+}
+
+void HaloExchange::flush(const placed_vector<float> &dist)
+{
+    for (size_t n = 0; n < neighbor_ranks.size(); n++)
+    {
+        if (pending[n].empty())
+            continue;
+
+        // Find a free send slot; if all are in flight the changes stay
+        // queued and are coalesced into the next batch
+        int free_slot = -1;
+        for (int i = 0; i < max_in_flight && free_slot < 0; i++)
+        {
+            int done = 1;
+            if (send_reqs[n][i] != MPI_REQUEST_NULL)
+                MPI_Test(&send_reqs[n][i], &done, MPI_STATUS_IGNORE);
+            if (done)
+                free_slot = i;
+        }
+        if (free_slot < 0)
+            continue;
+
+        auto &buf = send_bufs[n][free_slot];
+        buf.clear();
+        for (edge_t s : pending[n])
+        {
+            slot_pending[s] = 0;
+            buf.push_back({dist[slot_vertex[s]], slot_vertex[s]});
+        }
+        pending[n].clear();
+
+        MPI_Isend(buf.data(), buf.size(), boundaryUpdateType(), neighbor_ranks[n],
+                  tag, comm, &send_reqs[n][free_slot]);
+        messages_sent++;
+    }
+}
+
+bool HaloExchange::poll(std::vector<BoundaryUpdate> &arrived)
+{
+    if (recv_reqs.empty())
+        return false;
+
+    int outcount = 0;
+    indices.resize(recv_reqs.size());
+    statuses.resize(recv_reqs.size());
+    MPI_Testsome(recv_reqs.size(), recv_reqs.data(), &outcount, indices.data(), statuses.data());
+    if (outcount == MPI_UNDEFINED)
+        return false;
+
+    // Room for a full buffer from every neighbour, so a poll that happens to
+    // catch more than any before it does not reallocate
+    arrived.reserve(arrived.size() + recv_total);
+    for (int i = 0; i < outcount; i++)
+    {
+        int n = indices[i];
+        int count = 0;
+        MPI_Get_count(&statuses[i], boundaryUpdateType(), &count);
+        arrived.insert(arrived.end(), recv_bufs[n].begin(), recv_bufs[n].begin() + count);
+        messages_received++;
+
+        // Re-post immediately; one outstanding receive per neighbour keeps
+        // batches from the same sender in order
+        MPI_Irecv(recv_bufs[n].data(), recv_bufs[n].size(), boundaryUpdateType(),
+                  neighbor_ranks[n], tag, comm, &recv_reqs[n]);
+    }
+    return outcount > 0;
+}
+
+bool HaloExchange::hasPending() const
+{
+    for (const auto &p : pending)
+    {
+        if (!p.empty())
+            return true;
+    }
+    return false;
+}
+
+void HaloExchange::exchangeAll(placed_vector<float> &dist)
+{
+    reqs.clear();
+    reqs.reserve(2 * neighbor_ranks.size());
+
+    for (size_t n = 0; n < neighbor_ranks.size(); n++)
+    {
+        reqs.emplace_back();
+        MPI_Irecv(in[n].data(), in[n].size(), MPI_FLOAT, neighbor_ranks[n],
+                  REFRESH_TAG, comm, &reqs.back());
+    }
+    for (size_t n = 0; n < neighbor_ranks.size(); n++)
+    {
+        for (size_t i = 0; i < send_lists[n].size(); i++)
+            out[n][i] = dist[send_lists[n][i]];
+        reqs.emplace_back();
+        MPI_Isend(out[n].data(), out[n].size(), MPI_FLOAT, neighbor_ranks[n],
+                  REFRESH_TAG, comm, &reqs.back());
+    }
+    MPI_Waitall(reqs.size(), reqs.data(), MPI_STATUSES_IGNORE);
+
+    for (size_t n = 0; n < neighbor_ranks.size(); n++)
+    {
+        for (size_t i = 0; i < recv_lists[n].size(); i++)
+            dist[recv_lists[n][i]] = in[n][i];
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef HALO_EXCHANGE_H
+#define HALO_EXCHANGE_H
+
+#include "graph.h"
+#include "numa_utils.h"
+#include <vector>
+#include <mpi.h>
+
+// Boundary distance as sent over the wire; see boundaryUpdateType()
+struct BoundaryUpdate
+{
+    float dist;
+    vertex_t vertex;
+};
+
+MPI_Datatype boundaryUpdateType();
+
+// Non-blocking exchange of boundary distances between neighbouring ranks.
+// Owners are authoritative for their vertices: changed boundary values are
+// queued with markChanged(), shipped with flush() and applied by the
+// receiver as ghost values. At most max_in_flight batches per neighbour are
+// outstanding; further changes are coalesced until a send slot frees up.
+class HaloExchange
+{
+public:
+    // Exchange plan, identical (sorted) lists on both sides of each pair
+    std::vector<int> neighbor_ranks;
+    std::vector<std::vector<vertex_t>> send_lists;
+    std::vector<std::vector<vertex_t>> recv_lists;
+
+    // Message counters used for termination detection
+    long long messages_sent = 0;
+    long long messages_received = 0;
+
+    // Local vertex -> neighbour slots (CSR), one slot per (vertex, neighbour)
+    std::vector<edge_t> slot_offsets;
+    std::vector<int> slot_neighbor;
+    std::vector<vertex_t> slot_vertex;
+    std::vector<char> slot_pending;
+    std::vector<std::vector<edge_t>> pending;
+
+    // Communication buffers, max_in_flight send slots per neighbour
+    MPI_Comm comm = MPI_COMM_NULL;
+    int max_in_flight = 1;
+    int tag = 0;
+    bool active = false;
+    std::vector<std::vector<std::vector<BoundaryUpdate>>> send_bufs;
+    std::vector<std::vector<MPI_Request>> send_reqs;
+    std::vector<std::vector<BoundaryUpdate>> recv_bufs;
+    size_t recv_total = 0; // Updates in all receive buffers together
+    std::vector<MPI_Request> recv_reqs;
+
+    // Scratch for setup(), poll() and exchangeAll(), kept between calls
+    std::vector<int> rank_index;
+    std::vector<edge_t> fill;
+    std::vector<int> indices;
+    std::vector<MPI_Status> statuses;
+    std::vector<std::vector<float>> out, in;
+    std::vector<MPI_Request> reqs;
+
+    ~HaloExchange();
+
+    void setup(const Graph &graph, MPI_Comm comm, int max_in_flight);
+    void begin(int phase);
+    void end();
+    void markChanged(vertex_t v);
+    void flush(const placed_vector<float> &dist);
+    bool poll(std::vector<BoundaryUpdate> &arrived);
+    bool hasPending() const;
+    void exchangeAll(placed_vector<float> &dist);
+};
+
+#endif // HALO_EXCHANGE_H
@@ -0,0 +1,264 @@
+#include "landmarks.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+// The vertex with the largest finite score over all ranks, lowest ID on
+// ties; -1 if no score is positive
+static vertex_t farthestVertex(const Graph &graph, const std::vector<float> &score, MPI_Comm comm)
+{
+    const float INF = std::numeric_limits<float>::infinity();
+    float best = 0;
+    vertex_t best_vertex = graph.V;
+    for (vertex_t v : graph.local_vertices)
+    {
+        if (score[v] != INF && (score[v] > best || (score[v] == best && v < best_vertex)))
+        {
+            best = score[v];
+            best_vertex = v;
+        }
+    }
+    float global_best;
+    MPI_Allreduce(&best, &global_best, 1, MPI_FLOAT, MPI_MAX, comm);
+    if (global_best <= 0)
+        return -1;
+    if (best != global_best)
+        best_vertex = graph.V;
+    MPI_Allreduce(MPI_IN_PLACE, &best_vertex, 1, MPI_VERTEX_T, MPI_MIN, comm);
+    return best_vertex;
+}
+
+void Landmarks::select(Graph &graph, const placed_vector<float> &source_dist, int k,
+                       MPI_Comm comm, bool use_openmp, int async_level)
+{
+    ids.clear();
+    trees.clear();
+    batches.clear();
+
+    // Each landmark is the vertex farthest from all chosen so far, which
+    // spreads them towards the edges of the graph where the bounds are tight
+    std::vector<float> score(source_dist.begin(), source_dist.end());
+    for (int i = 0; i < k; i++)
+    {
+        vertex_t landmark = farthestVertex(graph, score, comm);
+        if (landmark < 0)
+            break;
+
+        auto tree = std::make_unique<SSSP>(0);
+        tree->comm = comm;
+        tree->resize(graph.V, use_openmp);
+        tree->initialize(landmark, use_openmp);
+        tree->updateStep2(graph, use_openmp, async_level);
+        for (vertex_t v : graph.local_vertices)
+            score[v] = i == 0 ? tree->dist[v] : std::min(score[v], tree->dist[v]);
+        ids.push_back(landmark);
+        trees.push_back(std::move(tree));
+    }
+    prepare(graph, comm);
+}
+
+void Landmarks::classify(const Graph &graph, const std::vector<Edge> &updates, int rank)
+{
+    batches.resize(trees.size());
+    for (size_t l = 0; l < trees.size(); l++)
+        batches[l] = classifyUpdates(graph, trees[l]->parent, updates, rank);
+}
+
+void Landmarks::update(Graph &graph, MPI_Comm comm, bool use_openmp, int async_level)
+{
+    for (size_t l = 0; l < trees.size() && l < batches.size(); l++)
+    {
+        trees[l]->updateStep1(graph, batches[l].inserts, batches[l].deletes, batches[l].increases,
+                              use_openmp);
+        trees[l]->updateStep2(graph, use_openmp, async_level);
+    }
+    batches.clear();
+    prepare(graph, comm);
+}
+
+// Query state for the current graph: the boundary plan and delta
+void Landmarks::prepare(const Graph &graph, MPI_Comm comm)
+{
+    halo.setup(graph, comm, 1);
+    if (g.size() != static_cast<size_t>(graph.V))
+    {
+        placedFill(g, graph.V, std::numeric_limits<float>::infinity(), false);
+        placedFill(bound, graph.V, -1.0f, false);
+    }
+
+    double sums[2] = {0, 0};
+    for (vertex_t v : graph.local_vertices)
+    {
+        graph.forEachNeighbor(v, [&](vertex_t, float weight)
+                              {
+                                  sums[0] += weight;
+                                  sums[1] += 1; });
+    }
+    MPI_Allreduce(MPI_IN_PLACE, sums, 2, MPI_DOUBLE, MPI_SUM, comm);
+    delta = sums[1] > 0 ? static_cast<float>(sums[0] / sums[1]) : 1;
+}
+
+// min over targets of max over landmarks of |d(L, t) - d(L, v)|. A vertex a
+// landmark reaches while the target is cut off from it (or the reverse) has
+// no path to that target at all.
+float Landmarks::lowerBound(vertex_t v, size_t num_targets)
+{
+    const float INF = std::numeric_limits<float>::infinity();
+    if (bound[v] >= 0)
+        return bound[v];
+
+    float best = INF;
+    for (size_t t = 0; t < num_targets && best > 0; t++)
+    {
+        float h = 0;
+        for (size_t l = 0; l < trees.size(); l++)
+        {
+            float to_target = target_dist[l * num_targets + t];
+            float to_v = trees[l]->dist[v];
+            if (to_target == INF && to_v == INF)
+                continue;
+            if (to_target == INF || to_v == INF)
+            {
+                h = INF;
+                break;
+            }
+            h = std::max(h, std::fabs(to_target - to_v));
+        }
+        best = std::min(best, h);
+    }
+    bound[v] = best;
+    return best;
+}
+
+TargetQuery Landmarks::query(const Graph &graph, vertex_t from, const std::vector<vertex_t> &targets,
+                             MPI_Comm comm)
+{
+    const float INF = std::numeric_limits<float>::infinity();
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    auto is_local = [&](vertex_t v)
+    { return graph.part.empty() || graph.part[v] == rank; };
+    auto valid = [&](vertex_t v)
+    { return v >= 0 && v < graph.V; };
+
+    size_t num_targets = targets.size();
+    TargetQuery result;
+    result.dist.assign(num_targets, INF);
+    if (num_targets == 0 || !valid(from))
+        return result;
+
+    // d(L, t) for every landmark and target, from the targets' owners
+    target_dist.assign(trees.size() * num_targets, INF);
+    for (size_t l = 0; l < trees.size(); l++)
+    {
+        for (size_t t = 0; t < num_targets; t++)
+        {
+            if (valid(targets[t]) && is_local(targets[t]))
+                target_dist[l * num_targets + t] = trees[l]->dist[targets[t]];
+        }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, target_dist.data(), target_dist.size(), MPI_FLOAT, MPI_MIN, comm);
+
+    // Min-heap of (g + bound, vertex); an entry is stale once g dropped
+    open.clear();
+    touched.clear();
+    auto relax = [&](vertex_t v, float d)
+    {
+        if (!(d < g[v]))
+            return;
+        if (g[v] == INF)
+            touched.push_back(v);
+        g[v] = d;
+        float h = lowerBound(v, num_targets);
+        if (h != INF)
+        {
+            open.emplace_back(d + h, v);
+            std::push_heap(open.begin(), open.end(), std::greater<>());
+        }
+    };
+    if (is_local(from))
+        relax(from, 0);
+
+    long long expanded = 0;
+    std::vector<float> state(num_targets + 1);
+    halo.begin(2);
+    for (;;)
+    {
+        while (!open.empty() && open.front().first > g[open.front().second] + bound[open.front().second])
+        {
+            std::pop_heap(open.begin(), open.end(), std::greater<>());
+            open.pop_back();
+        }
+
+        // Every target is settled once no open key is below its distance:
+        // the bound never overestimates, so no open vertex can still
+        // lead to a shorter path
+        state[0] = open.empty() ? INF : open.front().first;
+        for (size_t t = 0; t < num_targets; t++)
+            state[t + 1] = valid(targets[t]) && is_local(targets[t]) ? g[targets[t]] : INF;
+        MPI_Allreduce(MPI_IN_PLACE, state.data(), state.size(), MPI_FLOAT, MPI_MIN, comm);
+        result.rounds++;
+        bool settled = std::all_of(state.begin() + 1, state.end(), [&](float d)
+                                   { return d <= state[0]; });
+        if (state[0] == INF || settled)
+        {
+            std::copy(state.begin() + 1, state.end(), result.dist.begin());
+            break;
+        }
+
+        // Expand every local key up to the limit, including keys this
+        // round adds
+        float limit = state[0] + delta;
+        while (!open.empty() && open.front().first <= limit)
+        {
+            auto [key, u] = open.front();
+            std::pop_heap(open.begin(), open.end(), std::greater<>());
+            open.pop_back();
+            if (key > g[u] + bound[u])
+                continue;
+            expanded++;
+            halo.markChanged(u);
+            float g_u = g[u];
+            graph.forEachNeighbor(u, [&](vertex_t v, float weight)
+                                  {
+                                      if (is_local(v))
+                                          relax(v, g_u + weight); });
+        }
+
+        // Exchange until every boundary value sent this round has landed;
+        // neighbours of an arriving vertex are relaxed but wait for the
+        // next round to expand
+        for (;;)
+        {
+            halo.flush(g);
+            arrived.clear();
+            halo.poll(arrived);
+            for (const auto &update : arrived)
+            {
+                if (!(update.dist < g[update.vertex]))
+                    continue;
+                if (g[update.vertex] == INF)
+                    touched.push_back(update.vertex);
+                g[update.vertex] = update.dist;
+                graph.forEachNeighbor(update.vertex, [&](vertex_t v, float weight)
+                                      {
+                                          if (is_local(v))
+                                              relax(v, update.dist + weight); });
+            }
+            long long counts[3] = {halo.messages_sent, halo.messages_received, halo.hasPending() ? 1 : 0};
+            MPI_Allreduce(MPI_IN_PLACE, counts, 3, MPI_LONG_LONG, MPI_SUM, comm);
+            if (counts[0] == counts[1] && counts[2] == 0)
+                break;
+        }
+    }
+    halo.end();
+
+    for (vertex_t v : touched)
+    {
+        g[v] = INF;
+        bound[v] = -1;
+    }
+    MPI_Allreduce(&expanded, &result.expanded, 1, MPI_LONG_LONG, MPI_SUM, comm);
+    return result;
+}
@@ -0,0 +1,68 @@
+#ifndef LANDMARKS_H
+#define LANDMARKS_H
+
+#include "graph.h"
+#include "sssp.h"
+#include "update_batch.h"
+#include "halo_exchange.h"
+#include "numa_utils.h"
+#include <memory>
+#include <utility>
+#include <vector>
+#include <mpi.h>
+
+// Answer to a point-to-point query, replicated on every rank
+struct TargetQuery
+{
+    std::vector<float> dist;  // Per target, infinity if unreachable
+    long long expanded = 0;   // Vertices expanded over all ranks
+    int rounds = 0;           // Global rounds until every target was settled
+};
+
+// ALT: shortest-path trees rooted at a few landmarks, kept current by the
+// same Step 1/Step 2 repair as the main tree. The graph is undirected, so
+// one tree gives distances both to and from a landmark, and by the triangle
+// inequality |d(L, t) - d(L, v)| never exceeds d(v, t).
+//
+// query() runs A* under that bound from any vertex to a set of targets.
+// Ranks expand their own vertices in rounds of keys below the global
+// minimum plus delta, exchanging boundary values like Step 2 does, and stop
+// as soon as no open vertex can still improve a target.
+class Landmarks
+{
+public:
+    std::vector<vertex_t> ids;
+    std::vector<std::unique_ptr<SSSP>> trees;
+    std::vector<UpdateBatch> batches; // Each tree's share of the current batch
+    float delta = 1;                  // Key range a round expands; mean edge weight
+
+    // Query state; g and bound are reset vertex by vertex after each query
+    HaloExchange halo;
+    placed_vector<float> g;
+    placed_vector<float> bound; // Lower bound to the nearest target, -1 unknown
+    std::vector<vertex_t> touched;
+    std::vector<std::pair<float, vertex_t>> open;
+    std::vector<BoundaryUpdate> arrived;
+    std::vector<float> target_dist; // d(L, t) per landmark and target
+
+    // Picks k landmarks by farthest-point selection, starting from the
+    // vertex farthest from the main tree's source, and builds their trees.
+    // Collective.
+    void select(Graph &graph, const placed_vector<float> &source_dist, int k,
+                MPI_Comm comm, bool use_openmp, int async_level);
+
+    // Classifies the rank's updates against every tree; must run before
+    // the graph changes
+    void classify(const Graph &graph, const std::vector<Edge> &updates, int rank);
+
+    // Repairs every tree after the graph changed. Collective.
+    void update(Graph &graph, MPI_Comm comm, bool use_openmp, int async_level);
+
+    TargetQuery query(const Graph &graph, vertex_t from, const std::vector<vertex_t> &targets,
+                      MPI_Comm comm);
+
+    void prepare(const Graph &graph, MPI_Comm comm);
+    float lowerBound(vertex_t v, size_t num_targets);
+};
+
+#endif // LANDMARKS_H
@@ -1,11 +1,276 @@
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <mpi.h>
 #include <string>
 #include <vector>
 #include <limits>
-#include "graph.h"
-#include "sssp.h"
+#include <stdexcept>
+#include "dynamic_sssp.h"
 #include "utils.h"
+#include "relax_simd.h"
+#include "update_ring.h"
+
+// What one batch did, on rank 0
+static void printBatch(const DynamicSSSP &engine, const BatchStats &stats, double seconds)
+{
+    std::cout << "Coalesced to " << stats.coalesced << " net updates" << std::endl;
+    std::cout << "Processed " << stats.inserts << " insertions and "
+              << stats.deletes << " tree-edge deletions, dropped "
+              << stats.dropped << " no-op updates (cut edges count once per owner)" << std::endl;
+    std::cout << "Weight changes: " << stats.decreases << " decreases, " << stats.increases
+              << " tree-edge increases (" << stats.reparented << " re-parented)" << std::endl;
+    if (engine.settings().epsilon > 0)
+        std::cout << "Approximate mode saved " << stats.skipped << " relaxations and "
+                  << stats.spared << " subtree invalidations" << std::endl;
+    if (stats.allocations >= 0)
+        std::cout << "Heap allocations in Step 1/2 and publishing: " << stats.allocations << std::endl;
+    if (stats.strategy == UPDATE_HIERARCHY)
+    {
+        if (stats.customized < 0)
+            std::cout << "Contraction hierarchy rebuilt for new edges" << std::endl;
+        else
+            std::cout << "Re-customized " << stats.customized << " hierarchy arcs" << std::endl;
+    }
+    std::cout << "Published snapshot " << engine.snapshot().epoch() << ", "
+              << stats.snapshot_pages << " pages copied" << std::endl;
+    std::cout << "SSSP update completed in " << seconds << " seconds\n";
+}
+
+// Command-line driver: one graph, one update batch (or a stream of them from
+// a shared-memory ring), results to a file
+static int run(DynamicSSSP &engine, const std::string &graph_file, const std::string &updates_file,
+               vertex_t source, const std::string &output_file, const std::string &save_graph_file,
+               bool binary_output, bool mpiio_output, bool bench_relax, const std::string &targets,
+               const std::string &compare_file, const std::string &ring_name)
+{
+    int rank;
+    MPI_Comm_rank(engine.communicator(), &rank);
+    const Graph &graph = engine.localGraph();
+
+    double load_start = MPI_Wtime();
+    if (rank == 0)
+    {
+        std::cout << "Loading graph from " << graph_file << std::endl;
+    }
+    if (!engine.loadGraph(graph_file))
+    {
+        return 1;
+    }
+    if (rank == 0)
+    {
+        std::cout << "Graph loaded: " << graph.V << " vertices, " << graph.E << " edges in "
+                  << (MPI_Wtime() - load_start) << " seconds" << std::endl;
+    }
+
+    if (!save_graph_file.empty())
+    {
+        engine.saveGraph(save_graph_file);
+        if (rank == 0)
+        {
+            std::cout << "Binary graph saved to " << save_graph_file << std::endl;
+        }
+    }
+
+    if (rank == 0)
+    {
+        std::cout << "Graph distributed. Process 0 has " << graph.local_vertices.size()
+                  << " local vertices and " << graph.ghost_vertices.size() << " ghost vertices" << std::endl;
+        std::cout << "Running initial SSSP calculation from source " << source << std::endl;
+    }
+
+    if (!engine.setSource(source))
+    {
+        return 1;
+    }
+
+    if (mpiio_output)
+    {
+        printStatsDistributed(graph, engine.distances(), engine.communicator());
+    }
+    else if (rank == 0)
+    {
+        std::cout << "Initial SSSP completed. Statistics:" << std::endl;
+        printStats(engine.distances());
+    }
+
+    if (bench_relax && rank == 0)
+    {
+        std::cout << "Relaxation kernels on rank 0's partition:" << std::endl;
+        benchmarkRelaxKernels(graph, engine.distances(), rank);
+    }
+
+    if (ring_name.empty())
+    {
+        std::vector<Edge> all_updates;
+        if (rank == 0)
+        {
+            std::cout << "Loading updates from " << updates_file << std::endl;
+            all_updates = loadUpdates(updates_file);
+            std::cout << "Loaded " << all_updates.size() << " updates" << std::endl;
+        }
+
+        double start_time = MPI_Wtime();
+        BatchStats stats = engine.applyBatch(all_updates);
+        double end_time = MPI_Wtime();
+        if (rank == 0)
+            printBatch(engine, stats, end_time - start_time);
+    }
+    else
+    {
+        // Rank 0 drains the ring batch by batch and tells the others
+        // whether another batch follows
+        UpdateRing ring;
+        int ok = 1;
+        if (rank == 0)
+        {
+            ok = ring.create(ring_name) ? 1 : 0;
+            if (ok)
+                std::cout << "Waiting for updates on shared-memory ring " << ring_name << std::endl;
+        }
+        MPI_Bcast(&ok, 1, MPI_INT, 0, engine.communicator());
+        if (!ok)
+            return 1;
+
+        std::vector<Edge> batch;
+        long long batches = 0, received = 0;
+        double busy = 0;
+        for (;;)
+        {
+            int more = rank == 0 && ring.nextBatch(batch) ? 1 : 0;
+            MPI_Bcast(&more, 1, MPI_INT, 0, engine.communicator());
+            if (!more)
+                break;
+            batches++;
+            received += batch.size();
+            if (rank == 0)
+                std::cout << "Batch " << batches << ": " << batch.size() << " updates from the ring" << std::endl;
+
+            double start_time = MPI_Wtime();
+            BatchStats stats = engine.applyBatch(batch);
+            double end_time = MPI_Wtime();
+            busy += end_time - start_time;
+            if (rank == 0)
+                printBatch(engine, stats, end_time - start_time);
+        }
+        if (rank == 0)
+        {
+            std::cout << "Update stream ended after " << batches << " batches, " << received << " updates in "
+                      << busy << " seconds of updating; the producer waited " << ring.producerStalls()
+                      << " times for a full ring" << std::endl;
+        }
+    }
+
+    // <from>:<t1>,<t2>,... answered by the goal-directed search
+    if (!targets.empty())
+    {
+        vertex_t from = -1;
+        std::vector<vertex_t> ids;
+        try
+        {
+            size_t colon = targets.find(':');
+            if (colon == std::string::npos)
+                throw std::invalid_argument(targets);
+            from = static_cast<vertex_t>(std::stoll(targets.substr(0, colon)));
+            for (size_t pos = colon; pos != std::string::npos; pos = targets.find(',', pos + 1))
+                ids.push_back(static_cast<vertex_t>(std::stoll(targets.substr(pos + 1))));
+        }
+        catch (const std::exception &e)
+        {
+            if (rank == 0)
+                std::cerr << "Warning: Could not parse targets '" << targets << "'" << std::endl;
+            ids.clear();
+        }
+        if (!ids.empty())
+        {
+            double query_start = MPI_Wtime();
+            TargetQuery answer = engine.queryTargets(from, ids);
+            double query_end = MPI_Wtime();
+            if (rank == 0)
+            {
+                for (size_t t = 0; t < ids.size(); t++)
+                    std::cout << "Distance " << from << " -> " << ids[t] << ": " << answer.dist[t] << std::endl;
+                std::cout << "Target query expanded " << answer.expanded << " vertices in "
+                          << answer.rounds << " rounds, " << (query_end - query_start) << " seconds" << std::endl;
+            }
+        }
+    }
+
+    // Realized error against an exact run, such as the Sequencial baseline's
+    // output for the same graph and updates
+    if (!compare_file.empty() && mpiio_output)
+    {
+        if (rank == 0)
+            std::cerr << "Warning: --compare needs the gathered results; ignored with --mpiio" << std::endl;
+    }
+    else if (!compare_file.empty() && rank == 0)
+    {
+        std::vector<float> exact = loadResults(compare_file, graph.V);
+        const std::vector<float> &dist = engine.distances();
+        if (exact.size() == dist.size())
+        {
+            const float INF = std::numeric_limits<float>::infinity();
+            double max_error = 0;
+            vertex_t worst = -1;
+            long long differ = 0, reachability = 0;
+            for (vertex_t v = 0; v < graph.V; v++)
+            {
+                if ((exact[v] == INF) != (dist[v] == INF))
+                {
+                    reachability++;
+                    continue;
+                }
+                if (exact[v] == INF || dist[v] == exact[v])
+                    continue;
+                differ++;
+                double error = exact[v] > 0 ? std::abs(dist[v] - exact[v]) / exact[v] : INF;
+                if (error > max_error)
+                {
+                    max_error = error;
+                    worst = v;
+                }
+            }
+            std::cout << "Against " << compare_file << ": " << differ << " distances differ, max relative error "
+                      << max_error;
+            if (worst >= 0)
+                std::cout << " at vertex " << worst << " (" << dist[worst] << " vs " << exact[worst] << ")";
+            std::cout << ", " << reachability << " reachability mismatches" << std::endl;
+        }
+    }
+
+    if (mpiio_output)
+    {
+        // Every rank writes its own vertices; nothing is gathered
+        printStatsDistributed(graph, engine.distances(), engine.communicator());
+
+        if (!output_file.empty())
+        {
+            double write_start = MPI_Wtime();
+            saveResultsMPIIO(output_file, graph, engine.distances(), binary_output, engine.communicator());
+            if (rank == 0)
+            {
+                std::cout << "Results saved to " << output_file << " in "
+                          << (MPI_Wtime() - write_start) << " seconds\n";
+            }
+        }
+    }
+    else if (rank == 0)
+    {
+        printStats(engine.distances());
+
+        if (!output_file.empty())
+        {
+            double write_start = MPI_Wtime();
+            if (binary_output)
+                saveResultsBinary(output_file, engine.distances());
+            else
+                saveResults(output_file, engine.distances(), engine.settings().use_openmp);
+            std::cout << "Results saved to " << output_file << " in "
+                      << (MPI_Wtime() - write_start) << " seconds\n";
+        }
+    }
+    return 0;
+}
 
 int main(int argc, char **argv)
 {
@@ -20,7 +285,7 @@ int main(int argc, char **argv)
         if (rank == 0)
         {
             std::cerr << "Usage: " << argv[0]
-                      << " <graph_file> <updates_file> <source_vertex> [output_file] [--openmp] [--async=<level>] [--opencl]" << std::endl;
+                      << " <graph_file> <updates_file> <source_vertex> [output_file] [--openmp] [--async=<level>] [--opencl] [--binary] [--mpiio] [--parallel-load] [--save-graph=<file>] [--compressed] [--pin-threads] [--bench-relax] [--direction=auto|push|pull] [--landmarks=<k>] [--targets=<from>:<t1>,<t2>,...] [--cch] [--epsilon=<e>] [--compare=<exact_output>] [--no-cost-model] [--ring=<name>]" << std::endl;
         }
         MPI_Finalize();
         return 1;
@@ -30,10 +295,13 @@ int main(int argc, char **argv)
     std::string updates_file = argv[2];
 
     // Check if the source vertex is a valid number
-    int source;
+    vertex_t source;
     try
     {
-        source = std::stoi(argv[3]);
+        long long value = std::stoll(argv[3]);
+        if (value > std::numeric_limits<vertex_t>::max())
+            throw std::out_of_range("source");
+        source = static_cast<vertex_t>(value);
     }
     catch (const std::exception &e)
     {
@@ -49,7 +317,22 @@ int main(int argc, char **argv)
     std::string output_file = "";
     bool use_openmp = false;
     bool use_opencl = false;
+    bool binary_output = false;
+    bool mpiio_output = false;
+    bool parallel_load = false;
+    bool compress_graph = false;
+    bool pin_threads = false;
+    bool bench_relax = false;
+    bool use_cch = false;
+    bool cost_model = true;
+    float epsilon = 0;
+    std::string compare_file = "";
+    RelaxDirection direction = RELAX_AUTO;
+    std::string save_graph_file = "";
     int async_level = 1;
+    int landmarks = 0;
+    std::string targets = "";
+    std::string ring_name = "";
 
     // Process optional arguments
     for (int i = 4; i < argc; i++)
@@ -64,6 +347,92 @@ int main(int argc, char **argv)
         {
             use_opencl = true;
         }
+        else if (arg == "--binary")
+        {
+            binary_output = true;
+        }
+        else if (arg == "--mpiio")
+        {
+            mpiio_output = true;
+        }
+        else if (arg == "--parallel-load")
+        {
+            parallel_load = true;
+        }
+        else if (arg == "--compressed")
+        {
+            compress_graph = true;
+        }
+        else if (arg == "--pin-threads")
+        {
+            pin_threads = true;
+        }
+        else if (arg == "--bench-relax")
+        {
+            bench_relax = true;
+        }
+        else if (arg == "--cch")
+        {
+            use_cch = true;
+        }
+        else if (arg == "--no-cost-model")
+        {
+            cost_model = false;
+        }
+        else if (arg.compare(0, 12, "--direction=") == 0)
+        {
+            std::string value = arg.substr(12);
+            if (value == "push")
+                direction = RELAX_PUSH;
+            else if (value == "pull")
+                direction = RELAX_PULL;
+            else if (value == "auto")
+                direction = RELAX_AUTO;
+            else if (rank == 0)
+                std::cerr << "Warning: Unknown direction '" << value << "', using auto" << std::endl;
+        }
+        else if (arg.compare(0, 12, "--landmarks=") == 0)
+        {
+            try
+            {
+                landmarks = std::max(0, std::stoi(arg.substr(12)));
+            }
+            catch (const std::exception &e)
+            {
+                if (rank == 0)
+                    std::cerr << "Warning: Invalid landmark count, using none" << std::endl;
+                landmarks = 0;
+            }
+        }
+        else if (arg.compare(0, 10, "--targets=") == 0)
+        {
+            targets = arg.substr(10);
+        }
+        else if (arg.compare(0, 10, "--epsilon=") == 0)
+        {
+            try
+            {
+                epsilon = std::max(0.0f, std::stof(arg.substr(10)));
+            }
+            catch (const std::exception &e)
+            {
+                if (rank == 0)
+                    std::cerr << "Warning: Invalid epsilon, updating exactly" << std::endl;
+                epsilon = 0;
+            }
+        }
+        else if (arg.compare(0, 7, "--ring=") == 0)
+        {
+            ring_name = arg.substr(7);
+        }
+        else if (arg.compare(0, 10, "--compare=") == 0)
+        {
+            compare_file = arg.substr(10);
+        }
+        else if (arg.compare(0, 13, "--save-graph=") == 0)
+        {
+            save_graph_file = arg.substr(13);
+        }
         else if (arg.compare(0, 8, "--async=") == 0)
         {
             try
@@ -100,251 +469,57 @@ int main(int argc, char **argv)
         }
     }
 
+    // Every rank times the relaxation kernels now, before its threads
+    // compete for the cores
+    relaxKernel();
+
     if (rank == 0)
     {
         std::cout << "Configuration:" << std::endl;
         std::cout << "  Graph file: " << graph_file << std::endl;
-        std::cout << "  Updates file: " << updates_file << std::endl;
+        if (ring_name.empty())
+            std::cout << "  Updates file: " << updates_file << std::endl;
+        else
+            std::cout << "  Updates: shared-memory ring " << ring_name << std::endl;
         std::cout << "  Source vertex: " << source << std::endl;
-        std::cout << "  Output file: " << (output_file.empty() ? "none" : output_file) << std::endl;
+        std::cout << "  Output file: " << (output_file.empty() ? "none" : output_file)
+                  << (binary_output ? " (binary" : " (text") << (mpiio_output ? ", MPI-IO)" : ")") << std::endl;
         std::cout << "  OpenMP: " << (use_openmp ? "enabled" : "disabled") << std::endl;
         std::cout << "  OpenCL: " << (use_opencl ? "enabled" : "disabled") << std::endl;
         std::cout << "  Async level: " << async_level << std::endl;
+        std::cout << "  Graph loading: " << (parallel_load ? "parallel MPI-IO" : "rank 0") << std::endl;
+        std::cout << "  Adjacency: " << (compress_graph ? "compressed" : "lists") << std::endl;
+        std::cout << "  Relaxation kernel: " << relaxKernelName() << std::endl;
+        std::cout << "  Relaxation direction: "
+                  << (direction == RELAX_PUSH ? "push" : direction == RELAX_PULL ? "pull" : "auto") << std::endl;
+        std::cout << "  Landmarks: " << landmarks << std::endl;
+        std::cout << "  Contraction hierarchy: " << (use_cch ? "enabled" : "disabled") << std::endl;
+        std::cout << "  Epsilon: " << epsilon << (epsilon > 0 ? " (approximate updates)" : " (exact)") << std::endl;
     }
 
-    // Load graph and partition it
-    Graph graph;
-    if (rank == 0)
-    {
-        std::cout << "Loading graph from " << graph_file << std::endl;
-        graph.loadFromFile(graph_file);
-        std::cout << "Graph loaded: " << graph.V << " vertices, " << graph.E << " edges" << std::endl;
-        graph.partitionGraph(size);
-    }
-
-    // First broadcast graph size to all processes
-    int graph_info[2];
-    if (rank == 0)
-    {
-        graph_info[0] = graph.V;
-        graph_info[1] = graph.E;
-    }
-    MPI_Bcast(graph_info, 2, MPI_INT, 0, MPI_COMM_WORLD);
-
-    // Now non-root processes know the graph size
-    if (rank != 0)
-    {
-        graph.V = graph_info[0];
-        graph.E = graph_info[1];
-        graph.adj.resize(graph.V);
-        graph.part.resize(graph.V);
-    }
-
-    // Broadcast partition information
-    MPI_Bcast(graph.part.data(), graph.V, MPI_INT, 0, MPI_COMM_WORLD);
-
-    // Distribute graph data
-    std::vector<Edge> all_edges;
-    if (rank == 0)
-    {
-        all_edges = graph.edges;
-    }
-
-    int num_edges = (rank == 0) ? graph.E : 0;
-    MPI_Bcast(&num_edges, 1, MPI_INT, 0, MPI_COMM_WORLD);
-
-    if (rank != 0)
-    {
-        all_edges.resize(num_edges);
-    }
-
-    // Create custom MPI datatype for Edge
-    MPI_Datatype MPI_EDGE;
-    int blocklengths[3] = {1, 1, 1};
-    MPI_Aint offsets[3];
-    MPI_Datatype types[3] = {MPI_INT, MPI_INT, MPI_FLOAT};
-
-    Edge temp;
-    MPI_Aint base_address;
-    MPI_Get_address(&temp, &base_address);
-    MPI_Get_address(&temp.u, &offsets[0]);
-    MPI_Get_address(&temp.v, &offsets[1]);
-    MPI_Get_address(&temp.weight, &offsets[2]);
-    offsets[0] = MPI_Aint_diff(offsets[0], base_address);
-    offsets[1] = MPI_Aint_diff(offsets[1], base_address);
-    offsets[2] = MPI_Aint_diff(offsets[2], base_address);
-
-    MPI_Type_create_struct(3, blocklengths, offsets, types, &MPI_EDGE);
-    MPI_Type_commit(&MPI_EDGE);
-
-    // Broadcast edges
-    MPI_Bcast(all_edges.data(), num_edges, MPI_EDGE, 0, MPI_COMM_WORLD);
-
-    // Reconstruct graph if not root
-    if (rank != 0)
-    {
-        for (const auto &edge : all_edges)
-        {
-            graph.adj[edge.u].emplace_back(edge.v, edge.weight);
-            graph.adj[edge.v].emplace_back(edge.u, edge.weight);
-        }
-        graph.edges = all_edges;
-    }
-
-    graph.distributeGraph(MPI_COMM_WORLD);
-
-    if (rank == 0)
-    {
-        std::cout << "Graph distributed. Process 0 has " << graph.local_vertices.size()
-                  << " local vertices and " << graph.ghost_vertices.size() << " ghost vertices" << std::endl;
-    }
-
-    // Initialize SSSP
-    SSSP sssp(graph.V);
-    sssp.initialize(source);
-
-    if (rank == 0)
-    {
-        std::cout << "Running initial SSSP calculation from source " << source << std::endl;
-    }
-
-    sssp.updateStep2(graph, use_openmp, async_level, use_opencl);
-
-    MPI_Barrier(MPI_COMM_WORLD);
-
-    std::vector<float> initial_dist(graph.V);
-    for (int i = 0; i < graph.V; i++)
-    {
-        initial_dist[i] = sssp.dist[i];
-    }
-
-    graph.gatherSSSPResults(MPI_COMM_WORLD, initial_dist);
-
-    if (rank == 0)
-    {
-        std::cout << "Initial SSSP completed. Statistics:" << std::endl;
-        printStats(initial_dist);
-    }
-
-    // Load updates
-    std::vector<Edge> all_updates;
-    if (rank == 0)
-    {
-        std::cout << "Loading updates from " << updates_file << std::endl;
-        all_updates = loadUpdates(updates_file);
-        std::cout << "Loaded " << all_updates.size() << " updates" << std::endl;
-    }
-
-    int num_updates = (rank == 0) ? all_updates.size() : 0;
-    MPI_Bcast(&num_updates, 1, MPI_INT, 0, MPI_COMM_WORLD);
-
-    if (rank != 0)
-    {
-        all_updates.resize(num_updates);
-    }
-
-    MPI_Bcast(all_updates.data(), num_updates, MPI_EDGE, 0, MPI_COMM_WORLD);
-
-    std::vector<Edge> inserts, deletes;
-    for (const auto &e : all_updates)
-    {
-        if (e.weight >= 0)
-        {
-            inserts.push_back(e);
-        }
-        else
-        {
-            Edge delete_edge = {e.u, e.v, -1.0f};
-            for (const auto &adj_edge : graph.adj[e.u])
-            {
-                if (adj_edge.first == e.v)
-                {
-                    delete_edge.weight = adj_edge.second;
-                    break;
-                }
-            }
-            deletes.push_back(delete_edge);
-        }
-    }
-
-    if (rank == 0)
-    {
-        std::cout << "Processing " << inserts.size() << " insertions and "
-                  << deletes.size() << " deletions" << std::endl;
-    }
-
-    double start_time = MPI_Wtime();
-
-    graph.applyUpdates(all_updates); // Apply both insertions and deletions
-
-    // Redistribute updated graph
-    num_edges = graph.E;
-    std::vector<Edge> updated_edges;
-    if (rank == 0)
+    DynamicSSSPOptions options;
+    options.use_openmp = use_openmp;
+    options.use_opencl = use_opencl;
+    options.async_level = async_level;
+    options.parallel_load = parallel_load;
+    options.replicate_results = !mpiio_output;
+    options.compress_graph = compress_graph;
+    options.pin_threads = pin_threads;
+    options.direction = direction;
+    options.landmarks = landmarks;
+    options.use_cch = use_cch;
+    options.epsilon = epsilon;
+    options.cost_model = cost_model;
+
+    // The engine owns an MPI datatype, so it must be gone before MPI_Finalize
+    int status = 0;
     {
-        updated_edges.clear();
-        for (int u = 0; u < graph.V; u++)
-        {
-            for (const auto &neighbor : graph.adj[u])
-            {
-                int v = neighbor.first;
-                float weight = neighbor.second;
-                if (u < v) // Avoid duplicates in undirected graph
-                {
-                    updated_edges.push_back({u, v, weight});
-                }
-            }
-        }
-        num_edges = updated_edges.size();
-    }
-    MPI_Bcast(&num_edges, 1, MPI_INT, 0, MPI_COMM_WORLD);
-    if (rank != 0)
-    {
-        updated_edges.resize(num_edges);
-    }
-    MPI_Bcast(updated_edges.data(), num_edges, MPI_EDGE, 0, MPI_COMM_WORLD);
-    if (rank != 0)
-    {
-        graph.adj.clear();
-        graph.adj.resize(graph.V);
-        for (const auto &edge : updated_edges)
-        {
-            graph.adj[edge.u].emplace_back(edge.v, edge.weight);
-            graph.adj[edge.v].emplace_back(edge.u, edge.weight);
-        }
-        graph.edges = updated_edges;
-        graph.E = num_edges;
+        DynamicSSSP engine(MPI_COMM_WORLD, options);
+        status = run(engine, graph_file, updates_file, source, output_file,
+                     save_graph_file, binary_output, mpiio_output, bench_relax, targets,
+                     compare_file, ring_name);
     }
-    graph.distributeGraph(MPI_COMM_WORLD);
 
-    sssp.updateStep1(graph, inserts, deletes, use_openmp);
-
-    MPI_Barrier(MPI_COMM_WORLD);
-
-    sssp.updateStep2(graph, use_openmp, async_level, use_opencl);
-
-    std::vector<float> global_dist(graph.V, std::numeric_limits<float>::infinity());
-    for (int i = 0; i < graph.V; i++)
-    {
-        global_dist[i] = sssp.dist[i];
-    }
-    graph.gatherSSSPResults(MPI_COMM_WORLD, global_dist);
-
-    double end_time = MPI_Wtime();
-
-    if (rank == 0)
-    {
-        std::cout << "SSSP update completed in " << (end_time - start_time) << " seconds\n";
-        printStats(global_dist);
-
-        if (!output_file.empty())
-        {
-            saveResults(output_file, global_dist);
-            std::cout << "Results saved to " << output_file << "\n";
-        }
-    }
-
-    MPI_Type_free(&MPI_EDGE);
     MPI_Finalize();
-    return 0;
-}
\ No newline at end of file
+    return status;
+}
@@ -0,0 +1,102 @@
+#include "mpi_chunked.h"
+#include <algorithm>
+#include <cstring>
+
+static const int CHUNK_TAG = 40;
+
+static MPI_Aint extentOf(MPI_Datatype type)
+{
+    MPI_Aint lb, extent;
+    MPI_Type_get_extent(type, &lb, &extent);
+    return extent;
+}
+
+void bcastChunked(void *buf, int64_t count, MPI_Datatype type, int root, MPI_Comm comm)
+{
+    char *p = static_cast<char *>(buf);
+    MPI_Aint extent = extentOf(type);
+    for (int64_t done = 0; done < count; done += SSSP_MPI_CHUNK)
+    {
+        int n = static_cast<int>(std::min<int64_t>(SSSP_MPI_CHUNK, count - done));
+        MPI_Bcast(p + done * extent, n, type, root, comm);
+    }
+}
+
+void allreduceChunked(const void *sendbuf, void *recvbuf, int64_t count, MPI_Datatype type,
+                      MPI_Op op, MPI_Comm comm)
+{
+    const char *in = static_cast<const char *>(sendbuf);
+    char *out = static_cast<char *>(recvbuf);
+    MPI_Aint extent = extentOf(type);
+    for (int64_t done = 0; done < count; done += SSSP_MPI_CHUNK)
+    {
+        int n = static_cast<int>(std::min<int64_t>(SSSP_MPI_CHUNK, count - done));
+        const void *piece = (sendbuf == MPI_IN_PLACE) ? MPI_IN_PLACE : in + done * extent;
+        MPI_Allreduce(piece, out + done * extent, n, type, op, comm);
+    }
+}
+
+// Posts one request per chunk of a contiguous range
+static void postChunks(bool send, char *p, int64_t count, MPI_Aint extent, MPI_Datatype type,
+                       int peer, MPI_Comm comm, std::vector<MPI_Request> &reqs)
+{
+    for (int64_t done = 0; done < count; done += SSSP_MPI_CHUNK)
+    {
+        int n = static_cast<int>(std::min<int64_t>(SSSP_MPI_CHUNK, count - done));
+        reqs.emplace_back();
+        if (send)
+            MPI_Isend(p + done * extent, n, type, peer, CHUNK_TAG, comm, &reqs.back());
+        else
+            MPI_Irecv(p + done * extent, n, type, peer, CHUNK_TAG, comm, &reqs.back());
+    }
+}
+
+void alltoallvChunked(const void *sendbuf, const std::vector<int64_t> &send_counts,
+                      void *recvbuf, const std::vector<int64_t> &recv_counts,
+                      MPI_Datatype type, MPI_Comm comm)
+{
+    // Point-to-point, so no int displacement ever has to hold an offset
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    MPI_Aint extent = extentOf(type);
+    char *out = const_cast<char *>(static_cast<const char *>(sendbuf));
+    char *in = static_cast<char *>(recvbuf);
+
+    std::vector<MPI_Request> reqs;
+    int64_t send_off = 0, recv_off = 0, self_send = 0, self_recv = 0;
+    for (int r = 0; r < size; r++)
+    {
+        if (r == rank)
+        {
+            self_send = send_off;
+            self_recv = recv_off;
+        }
+        else
+        {
+            postChunks(false, in + recv_off * extent, recv_counts[r], extent, type, r, comm, reqs);
+            postChunks(true, out + send_off * extent, send_counts[r], extent, type, r, comm, reqs);
+        }
+        send_off += send_counts[r];
+        recv_off += recv_counts[r];
+    }
+    std::memcpy(in + self_recv * extent, out + self_send * extent, send_counts[rank] * extent);
+    MPI_Waitall(reqs.size(), reqs.data(), MPI_STATUSES_IGNORE);
+}
+
+void writeAtAllChunked(MPI_File fh, MPI_Offset offset, const void *buf, int64_t count,
+                       MPI_Datatype type, MPI_Comm comm)
+{
+    // Collective: every rank has to take part in the same number of rounds
+    int64_t rounds = (count + SSSP_MPI_CHUNK - 1) / SSSP_MPI_CHUNK;
+    MPI_Allreduce(MPI_IN_PLACE, &rounds, 1, MPI_INT64_T, MPI_MAX, comm);
+
+    const char *p = static_cast<const char *>(buf);
+    MPI_Aint extent = extentOf(type);
+    for (int64_t i = 0; i < rounds; i++)
+    {
+        int64_t done = std::min<int64_t>(i * SSSP_MPI_CHUNK, count);
+        int n = static_cast<int>(std::min<int64_t>(SSSP_MPI_CHUNK, count - done));
+        MPI_File_write_at_all(fh, offset + done * extent, p + done * extent, n, type, MPI_STATUS_IGNORE);
+    }
+}
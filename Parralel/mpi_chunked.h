@@ -0,0 +1,27 @@
+#ifndef MPI_CHUNKED_H
+#define MPI_CHUNKED_H
+
+#include <cstdint>
+#include <vector>
+#include <mpi.h>
+
+// Largest element count handed to a single MPI call. MPI counts are int, so
+// anything sized by V or E goes through these wrappers, which split the
+// transfer into pieces of at most this many elements.
+#ifndef SSSP_MPI_CHUNK
+#define SSSP_MPI_CHUNK (1 << 30)
+#endif
+
+void bcastChunked(void *buf, int64_t count, MPI_Datatype type, int root, MPI_Comm comm);
+void allreduceChunked(const void *sendbuf, void *recvbuf, int64_t count, MPI_Datatype type,
+                      MPI_Op op, MPI_Comm comm);
+
+// Buffers are laid out contiguously in rank order, displacements follow
+// from the counts
+void alltoallvChunked(const void *sendbuf, const std::vector<int64_t> &send_counts,
+                      void *recvbuf, const std::vector<int64_t> &recv_counts,
+                      MPI_Datatype type, MPI_Comm comm);
+void writeAtAllChunked(MPI_File fh, MPI_Offset offset, const void *buf, int64_t count,
+                       MPI_Datatype type, MPI_Comm comm);
+
+#endif // MPI_CHUNKED_H
@@ -0,0 +1,161 @@
+#include "numa_utils.h"
+#include <sched.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <omp.h>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// Below this a page-granular mapping is not worth it
+static const size_t MMAP_THRESHOLD = 1 << 20;
+
+void *allocatePages(size_t bytes)
+{
+    if (bytes < MMAP_THRESHOLD)
+        return ::operator new(bytes, std::align_val_t(HOST_ARRAY_ALIGN));
+    void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+        throw std::bad_alloc();
+    return p;
+}
+
+void freePages(void *p, size_t bytes)
+{
+    if (bytes < MMAP_THRESHOLD)
+        ::operator delete(p, std::align_val_t(HOST_ARRAY_ALIGN));
+    else
+        munmap(p, bytes);
+}
+
+#ifdef SSSP_COUNT_ALLOCS
+static std::atomic<long long> heap_allocations{0};
+
+void *operator new(size_t bytes)
+{
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(bytes ? bytes : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new(size_t bytes, std::align_val_t align)
+{
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    size_t a = static_cast<size_t>(align);
+    if (void *p = std::aligned_alloc(a, (bytes + a - 1) / a * a))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+long long heapAllocations()
+{
+    return heap_allocations.load(std::memory_order_relaxed);
+}
+#else
+long long heapAllocations()
+{
+    return -1;
+}
+#endif
+
+// NUMA node of a CPU from sysfs, -1 if the kernel does not say
+static int nodeOfCpu(int cpu)
+{
+    std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+    DIR *dir = opendir(path.c_str());
+    if (!dir)
+        return -1;
+    int node = -1;
+    while (dirent *entry = readdir(dir))
+    {
+        if (std::strncmp(entry->d_name, "node", 4) == 0)
+        {
+            node = std::atoi(entry->d_name + 4);
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
+
+bool pinThreads()
+{
+    if (omp_get_proc_bind() != omp_proc_bind_false)
+        return false;
+
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return false;
+    std::vector<int> cpus;
+    for (int c = 0; c < CPU_SETSIZE; c++)
+    {
+        if (CPU_ISSET(c, &allowed))
+            cpus.push_back(c);
+    }
+    if (cpus.empty())
+        return false;
+
+    // The runtime keeps the same threads for later teams of this size, so
+    // the pinning (and with it the first-touch placement) sticks
+#pragma omp parallel
+    {
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(cpus[omp_get_thread_num() % cpus.size()], &one);
+        sched_setaffinity(0, sizeof(one), &one);
+    }
+    return true;
+}
+
+void reportThreadPlacement(MPI_Comm comm)
+{
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    int threads = omp_get_max_threads();
+    std::vector<int> cpu(threads, -1), pinned(threads, 0);
+#pragma omp parallel num_threads(threads)
+    {
+        int t = omp_get_thread_num();
+        cpu[t] = sched_getcpu();
+        cpu_set_t mask;
+        if (sched_getaffinity(0, sizeof(mask), &mask) == 0)
+            pinned[t] = CPU_COUNT(&mask) == 1;
+    }
+
+    char host[256] = "";
+    gethostname(host, sizeof(host) - 1);
+    bool all_pinned = true;
+    std::string line = "  Rank " + std::to_string(rank) + " (" + host + "):";
+    for (int t = 0; t < threads; t++)
+    {
+        line += " " + std::to_string(cpu[t]) + "/n" + std::to_string(nodeOfCpu(cpu[t]));
+        all_pinned = all_pinned && pinned[t];
+    }
+    if (omp_get_proc_bind() != omp_proc_bind_false)
+        line += "  [OMP_PROC_BIND]";
+    else
+        line += all_pinned ? "  [pinned]" : "  [unpinned, threads may migrate]";
+    line += "\n";
+
+    int length = line.size();
+    std::vector<int> lengths(size), displs(size, 0);
+    MPI_Gather(&length, 1, MPI_INT, lengths.data(), 1, MPI_INT, 0, comm);
+    for (int r = 1; r < size; r++)
+        displs[r] = displs[r - 1] + lengths[r - 1];
+    std::string all(rank == 0 ? displs[size - 1] + lengths[size - 1] : 0, '\0');
+    MPI_Gatherv(line.data(), length, MPI_CHAR, &all[0], lengths.data(), displs.data(), MPI_CHAR, 0, comm);
+
+    if (rank == 0)
+        std::cout << "Thread placement (cpu/node per OpenMP thread):\n" << all << std::flush;
+}
@@ -0,0 +1,76 @@
+#ifndef NUMA_UTILS_H
+#define NUMA_UTILS_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+#include <mpi.h>
+
+// Blocks from allocatePages start on this boundary, so OpenCL can use the
+// per-vertex arrays in place (see OpenCLContext::zero_copy)
+const size_t HOST_ARRAY_ALIGN = 4096;
+
+void *allocatePages(size_t bytes);
+void freePages(void *p, size_t bytes);
+
+// Number of operator new calls so far in this process, or -1 unless built
+// with -DSSSP_COUNT_ALLOCS (which replaces the global operator new)
+long long heapAllocations();
+
+// Allocator for per-vertex arrays. Sizing a vector through it leaves the
+// elements uninitialised, and large blocks come straight from mmap, so no
+// page is touched until the array is filled. Filled with placedFill(), each
+// page then lands on the NUMA node of the thread that owns that block.
+template <typename T>
+struct PlacementAllocator
+{
+    typedef T value_type;
+
+    PlacementAllocator() = default;
+    template <typename U>
+    PlacementAllocator(const PlacementAllocator<U> &) {}
+
+    T *allocate(size_t n) { return static_cast<T *>(allocatePages(n * sizeof(T))); }
+    void deallocate(T *p, size_t n) { freePages(p, n * sizeof(T)); }
+
+    template <typename U>
+    void construct(U *p) { ::new (static_cast<void *>(p)) U; }
+    template <typename U, typename... Args>
+    void construct(U *p, Args &&...args) { ::new (static_cast<void *>(p)) U(std::forward<Args>(args)...); }
+};
+
+template <typename T, typename U>
+bool operator==(const PlacementAllocator<T> &, const PlacementAllocator<U> &) { return true; }
+template <typename T, typename U>
+bool operator!=(const PlacementAllocator<T> &, const PlacementAllocator<U> &) { return false; }
+
+template <typename T>
+using placed_vector = std::vector<T, PlacementAllocator<T>>;
+
+// Sets v to n copies of value with a static split over the OpenMP team.
+// A size change reallocates first so the new pages are first-touched here;
+// refills at the same size keep the pages where they are.
+template <typename T>
+void placedFill(placed_vector<T> &v, size_t n, const T &value, bool use_openmp)
+{
+    if (v.size() != n)
+    {
+        placed_vector<T>().swap(v);
+        v.resize(n);
+    }
+    T *data = v.data();
+#pragma omp parallel for schedule(static) if (use_openmp)
+    for (size_t i = 0; i < n; i++)
+        data[i] = value;
+}
+
+// Pins OpenMP thread t to the t-th CPU this rank may run on, unless the
+// runtime already binds threads (OMP_PROC_BIND). Returns true if it pinned.
+bool pinThreads();
+
+// Prints, on rank 0, the CPU and NUMA node every OpenMP thread of every rank
+// is running on
+void reportThreadPlacement(MPI_Comm comm);
+
+#endif // NUMA_UTILS_H
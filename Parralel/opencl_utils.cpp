@@ -1,9 +1,197 @@
 #define CL_TARGET_OPENCL_VERSION 120
 #include "opencl_utils.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
 
-bool setupOpenCL(OpenCLContext &ctx, const std::string &kernel_file)
+// relax_edges.cl, NUL-terminated. The assembler reads it relative to the
+// directory the compiler runs in, which is this one in the README's build
+// lines, so the executable no longer needs the file next to it at runtime.
+__asm__(".section .rodata\n"
+        ".global relax_edges_cl_source\n"
+        "relax_edges_cl_source:\n"
+        ".incbin \"relax_edges.cl\"\n"
+        ".byte 0\n"
+        ".previous\n");
+extern "C" const char relax_edges_cl_source[];
+
+static std::string kernelSource()
+{
+    const char *file = std::getenv("SSSP_CL_SOURCE");
+    if (!file)
+        return relax_edges_cl_source;
+
+    std::ifstream in(file);
+    if (!in.is_open())
+    {
+        std::cerr << "Cannot open kernel file " << file << ", using the built-in kernels" << std::endl;
+        return relax_edges_cl_source;
+    }
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+static std::string deviceString(cl_device_id device, cl_device_info param)
+{
+    size_t len = 0;
+    if (clGetDeviceInfo(device, param, 0, NULL, &len) != CL_SUCCESS || len == 0)
+        return "";
+    std::string value(len, '\0');
+    clGetDeviceInfo(device, param, len, &value[0], NULL);
+    value.resize(value.find('\0'));
+    return value;
+}
+
+// FNV-1a; cache keys only need to tell sources and devices apart
+static uint64_t hashString(const std::string &s, uint64_t h = 14695981039346656037ull)
+{
+    for (unsigned char c : s)
+        h = (h ^ c) * 1099511628211ull;
+    return h;
+}
+
+// Cache directory, created if missing; empty if caching is off
+static std::string cacheDirectory()
+{
+    std::string dir;
+    if (const char *env = std::getenv("SSSP_CL_CACHE"))
+    {
+        if (std::string(env) == "off")
+            return "";
+        dir = env;
+    }
+    else if (const char *xdg = std::getenv("XDG_CACHE_HOME"))
+        dir = std::string(xdg) + "/dynsssp";
+    else if (const char *home = std::getenv("HOME"))
+        dir = std::string(home) + "/.cache/dynsssp";
+    else
+        return "";
+
+    // mkdir -p; an existing directory is not an error
+    for (size_t pos = 1; pos <= dir.size(); pos++)
+    {
+        if (pos == dir.size() || dir[pos] == '/')
+            mkdir(dir.substr(0, pos).c_str(), 0755);
+    }
+    return dir;
+}
+
+// One file per device: the binary depends on the compiler as much as on
+// the source and options
+static std::string cachePath(const std::string &dir, cl_device_id device,
+                             const std::string &source, const std::string &options)
+{
+    uint64_t h = hashString(source);
+    h = hashString(options, h);
+    for (cl_device_info param : {CL_DEVICE_VENDOR, CL_DEVICE_NAME, CL_DEVICE_VERSION, CL_DRIVER_VERSION})
+        h = hashString(deviceString(device, param) + '\n', h);
+
+    std::ostringstream path;
+    path << dir << "/relax_edges-" << std::hex << h << ".bin";
+    return path.str();
+}
+
+static bool readFile(const std::string &path, std::vector<unsigned char> &data)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open())
+        return false;
+    data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return !data.empty();
+}
+
+// Several ranks may store the same binary at once; each writes its own
+// temporary file and renames it into place, so readers never see half
+static void writeFileAtomically(const std::string &path, const std::vector<unsigned char> &data)
+{
+    std::string tmp = path + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream out(tmp, std::ios::binary);
+        out.write(reinterpret_cast<const char *>(data.data()), data.size());
+        if (!out)
+        {
+            std::remove(tmp.c_str());
+            return;
+        }
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0)
+        std::remove(tmp.c_str());
+}
+
+static void printBuildLog(OpenCLContext &ctx)
+{
+    size_t len = 0;
+    clGetProgramBuildInfo(ctx.program, ctx.devices[0], CL_PROGRAM_BUILD_LOG, 0, NULL, &len);
+    std::vector<char> build_log(len + 1);
+    clGetProgramBuildInfo(ctx.program, ctx.devices[0], CL_PROGRAM_BUILD_LOG, len, build_log.data(), NULL);
+    std::cerr << "Build Log:\n"
+              << build_log.data() << std::endl;
+}
+
+// Builds the program from the cached binaries if every device has one
+static bool loadCachedProgram(OpenCLContext &ctx, const std::vector<std::string> &paths, const std::string &options)
+{
+    std::vector<std::vector<unsigned char>> binaries(paths.size());
+    for (size_t d = 0; d < paths.size(); d++)
+    {
+        if (!readFile(paths[d], binaries[d]))
+            return false;
+    }
+
+    std::vector<size_t> sizes;
+    std::vector<const unsigned char *> pointers;
+    for (const auto &binary : binaries)
+    {
+        sizes.push_back(binary.size());
+        pointers.push_back(binary.data());
+    }
+
+    // A binary from another driver build is rejected here or by the build,
+    // and the caller then compiles from source over it
+    cl_int err;
+    std::vector<cl_int> status(paths.size());
+    ctx.program = clCreateProgramWithBinary(ctx.context, ctx.devices.size(), ctx.devices.data(), sizes.data(),
+                                            pointers.data(), status.data(), &err);
+    if (err == CL_SUCCESS)
+        err = clBuildProgram(ctx.program, ctx.devices.size(), ctx.devices.data(), options.c_str(), NULL, NULL);
+    if (err != CL_SUCCESS && ctx.program)
+    {
+        clReleaseProgram(ctx.program);
+        ctx.program = nullptr;
+    }
+    return err == CL_SUCCESS;
+}
+
+static void storeProgramBinaries(OpenCLContext &ctx, const std::vector<std::string> &paths)
+{
+    std::vector<size_t> sizes(paths.size(), 0);
+    if (clGetProgramInfo(ctx.program, CL_PROGRAM_BINARY_SIZES, sizeof(size_t) * sizes.size(), sizes.data(), NULL) != CL_SUCCESS)
+        return;
+
+    std::vector<std::vector<unsigned char>> binaries(paths.size());
+    std::vector<unsigned char *> pointers;
+    for (size_t d = 0; d < paths.size(); d++)
+    {
+        binaries[d].resize(sizes[d]);
+        pointers.push_back(binaries[d].data());
+    }
+    if (clGetProgramInfo(ctx.program, CL_PROGRAM_BINARIES, sizeof(unsigned char *) * pointers.size(), pointers.data(), NULL) != CL_SUCCESS)
+        return;
+
+    for (size_t d = 0; d < paths.size(); d++)
+    {
+        if (!binaries[d].empty())
+            writeFileAtomically(paths[d], binaries[d]);
+    }
+}
+
+bool setupOpenCL(OpenCLContext &ctx, const KernelConfig &config)
 {
     cl_int err;
 
@@ -17,15 +205,17 @@ bool setupOpenCL(OpenCLContext &ctx, const std::string &kernel_file)
 
     // Get Devices
     cl_uint num_devices = 0;
-    err = clGetDeviceIDs(ctx.platform, CL_DEVICE_TYPE_GPU, 0, NULL, &num_devices);
+    cl_device_type type = CL_DEVICE_TYPE_GPU;
+    err = clGetDeviceIDs(ctx.platform, type, 0, NULL, &num_devices);
     if (num_devices == 0)
     {
         std::cerr << "No GPU devices available. Falling back to CPU." << std::endl;
-        err = clGetDeviceIDs(ctx.platform, CL_DEVICE_TYPE_CPU, 0, NULL, &num_devices);
+        type = CL_DEVICE_TYPE_CPU;
+        err = clGetDeviceIDs(ctx.platform, type, 0, NULL, &num_devices);
     }
     ctx.devices.resize(num_devices);
-    err = clGetDeviceIDs(ctx.platform, CL_DEVICE_TYPE_ALL, num_devices, ctx.devices.data(), NULL);
-    if (err != CL_SUCCESS)
+    err = clGetDeviceIDs(ctx.platform, type, num_devices, ctx.devices.data(), NULL);
+    if (err != CL_SUCCESS || num_devices == 0)
     {
         std::cerr << "Failed to get OpenCL devices." << std::endl;
         return false;
@@ -39,44 +229,84 @@ bool setupOpenCL(OpenCLContext &ctx, const std::string &kernel_file)
         return false;
     }
 
-    // Read kernel source
-    std::ifstream file(kernel_file);
-    if (!file.is_open())
+    // Specialise the kernels; the work-group size has to suit every device
+    ctx.work_group_size = config.work_group_size;
+    if (const char *wg = std::getenv("SSSP_CL_WG"))
+        ctx.work_group_size = std::max(1L, std::atol(wg));
+    for (cl_device_id device : ctx.devices)
     {
-        std::cerr << "Cannot open kernel file: " << kernel_file << std::endl;
-        return false;
+        size_t max_size = 0;
+        if (clGetDeviceInfo(device, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(max_size), &max_size, NULL) == CL_SUCCESS && max_size > 0)
+            ctx.work_group_size = std::min(ctx.work_group_size, max_size);
     }
-    std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-    const char *source_str = source.c_str();
+    const char *atomic = std::getenv("SSSP_CL_ATOMIC");
+    bool int_atomics = config.int_atomics && !(atomic && std::string(atomic) == "cas");
+    std::string options = "-DWG_SIZE=" + std::to_string(ctx.work_group_size) +
+                          " -DWEIGHT_T=float -DATOMIC_INT_MIN=" + (int_atomics ? "1" : "0");
+    std::string source = kernelSource();
 
-    // Create program
-    ctx.program = clCreateProgramWithSource(ctx.context, 1, &source_str, NULL, &err);
-    if (err != CL_SUCCESS)
+    std::string cache_dir = cacheDirectory();
+    std::vector<std::string> cache_paths;
+    if (!cache_dir.empty())
     {
-        std::cerr << "Failed to create OpenCL program." << std::endl;
-        return false;
+        for (cl_device_id device : ctx.devices)
+            cache_paths.push_back(cachePath(cache_dir, device, source, options));
     }
 
-    // Build Program
-    err = clBuildProgram(ctx.program, num_devices, ctx.devices.data(), NULL, NULL, NULL);
-    if (err != CL_SUCCESS)
+    auto start = std::chrono::steady_clock::now();
+    bool cached = !cache_paths.empty() && loadCachedProgram(ctx, cache_paths, options);
+    if (!cached)
     {
-        std::cerr << "Error building OpenCL program." << std::endl;
-        size_t len = 0;
-        clGetProgramBuildInfo(ctx.program, ctx.devices[0], CL_PROGRAM_BUILD_LOG, 0, NULL, &len);
-        std::vector<char> build_log(len);
-        clGetProgramBuildInfo(ctx.program, ctx.devices[0], CL_PROGRAM_BUILD_LOG, len, build_log.data(), NULL);
-        std::cerr << "Build Log:\n"
-                  << build_log.data() << std::endl;
-        return false;
+        // Create program
+        const char *source_str = source.c_str();
+        ctx.program = clCreateProgramWithSource(ctx.context, 1, &source_str, NULL, &err);
+        if (err != CL_SUCCESS)
+        {
+            std::cerr << "Failed to create OpenCL program." << std::endl;
+            return false;
+        }
+
+        // Build Program
+        err = clBuildProgram(ctx.program, num_devices, ctx.devices.data(), options.c_str(), NULL, NULL);
+        if (err != CL_SUCCESS)
+        {
+            std::cerr << "Error building OpenCL program." << std::endl;
+            printBuildLog(ctx);
+            return false;
+        }
+        if (!cache_paths.empty())
+            storeProgramBinaries(ctx, cache_paths);
     }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "OpenCL program " << (cached ? "loaded from cache" : "built from source") << " in "
+              << seconds << " seconds (" << options << ")" << std::endl;
 
-    // Create queue for device 0
-    ctx.queue = clCreateCommandQueue(ctx.context, ctx.devices[0], 0, &err);
-    if (!ctx.queue)
+    // One queue per device; profiling gives the kernel times the split
+    // across devices is weighted by
+    for (cl_device_id device : ctx.devices)
     {
-        std::cerr << "Failed to create command queue." << std::endl;
-        return false;
+        ctx.queues.push_back(clCreateCommandQueue(ctx.context, device, CL_QUEUE_PROFILING_ENABLE, &err));
+        if (!ctx.queues.back())
+        {
+            std::cerr << "Failed to create command queue." << std::endl;
+            return false;
+        }
+    }
+
+    // Several devices each need their own distances, so only a lone device
+    // in the host's memory works on the host arrays directly
+    const char *zero_copy = std::getenv("SSSP_CL_ZERO_COPY");
+    if (num_devices == 1 && !(zero_copy && std::string(zero_copy) == "off"))
+    {
+        cl_bool unified = CL_FALSE;
+        cl_uint align_bits = 0;
+        clGetDeviceInfo(ctx.devices[0], CL_DEVICE_HOST_UNIFIED_MEMORY, sizeof(unified), &unified, NULL);
+        clGetDeviceInfo(ctx.devices[0], CL_DEVICE_MEM_BASE_ADDR_ALIGN, sizeof(align_bits), &align_bits, NULL);
+        ctx.zero_copy = type == CL_DEVICE_TYPE_CPU || unified;
+        // Runtimes only skip the copy for page-aligned memory
+        ctx.host_align = std::max<size_t>(align_bits / 8, HOST_ARRAY_ALIGN);
+        if (ctx.zero_copy)
+            std::cout << "OpenCL buffers wrap the host arrays (zero-copy)" << std::endl;
     }
 
     return true;
@@ -84,170 +314,469 @@ bool setupOpenCL(OpenCLContext &ctx, const std::string &kernel_file)
 
 void cleanupOpenCL(OpenCLContext &ctx)
 {
-    if (ctx.queue)
-        clReleaseCommandQueue(ctx.queue);
+    for (cl_command_queue queue : ctx.queues)
+    {
+        if (queue)
+            clReleaseCommandQueue(queue);
+    }
+    ctx.queues.clear();
     if (ctx.program)
         clReleaseProgram(ctx.program);
     if (ctx.context)
         clReleaseContext(ctx.context);
+    ctx.program = nullptr;
+    ctx.context = nullptr;
 }
 
-bool runRelaxationKernel(OpenCLContext &ctx,
-                         std::vector<float> &dist,
-                         std::vector<int> &parent,
-                         const std::vector<std::pair<int, int>> &edges,
-                         const std::vector<float> &weights)
+// Reports a failed OpenCL call; true if err is CL_SUCCESS
+static bool checkCL(cl_int err, const char *what)
 {
-    cl_int err;
-    size_t num_edges = edges.size();
-    bool success = true;
+    if (err != CL_SUCCESS)
+        std::cerr << "Failed to " << what << ": " << err << std::endl;
+    return err == CL_SUCCESS;
+}
 
-    // Declare variables at the top to avoid goto issues
-    size_t global_size = num_edges;
-    size_t local_size = 64; // Adjust based on your device capabilities
+// Zero-copy hand-over of dist and parent, see DeviceGraph. Both are no-ops
+// for devices with their own copies.
+static bool mapHostArrays(DeviceGraph &dev)
+{
+    if (!dev.zero_copy || dev.mapped_dist)
+        return true;
+    const cl_map_flags access = CL_MAP_READ | CL_MAP_WRITE;
+    cl_int err, err_parent;
+    dev.mapped_dist = clEnqueueMapBuffer(dev.queue, dev.dist, CL_TRUE, access, 0, sizeof(float) * dev.num_vertices,
+                                         0, NULL, NULL, &err);
+    dev.mapped_parent = clEnqueueMapBuffer(dev.queue, dev.parent, CL_TRUE, access, 0, sizeof(cl_int) * dev.num_vertices,
+                                           0, NULL, NULL, &err_parent);
+    return checkCL(err, "map distances") && checkCL(err_parent, "map parents");
+}
 
-    // Check for empty input
-    if (num_edges == 0 || dist.empty() || parent.empty())
-    {
-        std::cerr << "Error: Empty input data for OpenCL kernel" << std::endl;
+static bool unmapHostArrays(DeviceGraph &dev)
+{
+    if (!dev.mapped_dist)
+        return true;
+    cl_int err = clEnqueueUnmapMemObject(dev.queue, dev.dist, dev.mapped_dist, 0, NULL, NULL);
+    if (dev.mapped_parent)
+        err |= clEnqueueUnmapMemObject(dev.queue, dev.parent, dev.mapped_parent, 0, NULL, NULL);
+    dev.mapped_dist = dev.mapped_parent = nullptr;
+    return checkCL(err, "unmap host arrays");
+}
+
+// Waits for the queue and gives the host its arrays back
+static bool finish(DeviceGraph &dev, const char *what)
+{
+    return checkCL(clFinish(dev.queue), what) && mapHostArrays(dev);
+}
+
+// Starts the queued work. The host carries on meanwhile unless it shares the
+// arrays, and then the device is mostly the host's own cores anyway.
+static bool flush(DeviceGraph &dev)
+{
+    if (dev.zero_copy)
+        return finish(dev, "wait for queue");
+    return checkCL(clFlush(dev.queue), "flush queue");
+}
+
+// The kernels require the work-group size they were built with
+static bool launch(OpenCLContext &ctx, DeviceGraph &dev, cl_kernel kernel, size_t items, const char *what,
+                   cl_event *event = NULL)
+{
+    if (items == 0)
+        return true;
+    if (!unmapHostArrays(dev))
         return false;
-    }
+    size_t local_size = ctx.work_group_size;
+    size_t global_size = ((items + local_size - 1) / local_size) * local_size;
+    if (checkCL(clEnqueueNDRangeKernel(dev.queue, kernel, 1, NULL, &global_size, &local_size, 0, NULL, event), what))
+        return true;
+    // The caller falls back to the host, which needs the arrays
+    mapHostArrays(dev);
+    return false;
+}
 
-    // Create buffers
-    cl_mem dist_buf = clCreateBuffer(ctx.context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
-                                     sizeof(float) * dist.size(), dist.data(), &err);
-    if (err != CL_SUCCESS)
+// Buffers need at least one byte even for an empty graph
+static cl_mem createBuffer(OpenCLContext &ctx, cl_mem_flags flags, size_t bytes, const void *host, cl_int &err)
+{
+    if (bytes == 0)
+        return clCreateBuffer(ctx.context, flags & ~CL_MEM_COPY_HOST_PTR, 1, NULL, &err);
+    return clCreateBuffer(ctx.context, flags, bytes, const_cast<void *>(host), &err);
+}
+
+// Read-only input: wrapped in place on a zero-copy device if the array is
+// aligned for it, copied otherwise
+static cl_mem inputBuffer(OpenCLContext &ctx, const DeviceGraph &dev, size_t bytes, const void *host, cl_int &err)
+{
+    bool wrap = dev.zero_copy && reinterpret_cast<uintptr_t>(host) % ctx.host_align == 0;
+    return createBuffer(ctx, CL_MEM_READ_ONLY | (wrap ? CL_MEM_USE_HOST_PTR : CL_MEM_COPY_HOST_PTR), bytes, host, err);
+}
+
+bool uploadGraph(OpenCLContext &ctx, DeviceGraph &dev, int index,
+                 const placed_vector<cl_uint> &offsets,
+                 const placed_vector<cl_int> &targets,
+                 const placed_vector<float> &weights,
+                 const std::vector<cl_int> &local_vertices,
+                 const placed_vector<cl_int> &owner,
+                 placed_vector<cl_int> &parent,
+                 placed_vector<float> &dist)
+{
+    releaseDeviceGraph(dev);
+    dev.index = index;
+    dev.queue = ctx.queues[index];
+    dev.num_vertices = dist.size();
+    dev.num_local = local_vertices.size();
+    dev.local_edges = 0;
+    for (cl_int v : local_vertices)
+        dev.local_edges += offsets[v + 1] - offsets[v];
+    dev.relaxed_edges = dev.busy_seconds = 0;
+
+    // Distances and parents are shared whole or not at all: the device
+    // writes them, and the host then reads its own arrays
+    auto aligned = [&](const void *p)
+    { return reinterpret_cast<uintptr_t>(p) % ctx.host_align == 0; };
+    dev.zero_copy = ctx.zero_copy && dev.num_vertices > 0 && aligned(dist.data()) && aligned(parent.data());
+    const cl_mem_flags inout = CL_MEM_READ_WRITE | (dev.zero_copy ? CL_MEM_USE_HOST_PTR : CL_MEM_COPY_HOST_PTR);
+
+    cl_int err = CL_SUCCESS;
+    dev.offsets = inputBuffer(ctx, dev, sizeof(cl_uint) * offsets.size(), offsets.data(), err);
+    if (err == CL_SUCCESS)
+        dev.targets = inputBuffer(ctx, dev, sizeof(cl_int) * targets.size(), targets.data(), err);
+    if (err == CL_SUCCESS)
+        dev.weights = inputBuffer(ctx, dev, sizeof(float) * weights.size(), weights.data(), err);
+    if (err == CL_SUCCESS)
+        dev.local_vertices = createBuffer(ctx, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(cl_int) * local_vertices.size(),
+                                          local_vertices.data(), err);
+    if (err == CL_SUCCESS)
+        dev.owner = inputBuffer(ctx, dev, sizeof(cl_int) * owner.size(), owner.data(), err);
+    if (err == CL_SUCCESS)
+        dev.dist = createBuffer(ctx, inout, sizeof(float) * dist.size(), dist.data(), err);
+    if (err == CL_SUCCESS)
+        dev.parent = createBuffer(ctx, inout, sizeof(cl_int) * parent.size(), parent.data(), err);
+    if (err == CL_SUCCESS)
+        dev.flags = createBuffer(ctx, CL_MEM_READ_WRITE, dev.num_vertices, NULL, err);
+    if (err == CL_SUCCESS)
+        dev.frontier = createBuffer(ctx, CL_MEM_READ_WRITE, sizeof(cl_int) * dev.num_vertices, NULL, err);
+    if (err == CL_SUCCESS)
+        dev.frontier_dist = createBuffer(ctx, CL_MEM_READ_WRITE, sizeof(float) * dev.num_vertices, NULL, err);
+    if (err == CL_SUCCESS)
+        dev.counters = createBuffer(ctx, CL_MEM_READ_WRITE, 2 * sizeof(cl_uint), NULL, err);
+    if (!checkCL(err, "create graph buffers"))
     {
-        std::cerr << "Failed to create dist buffer: " << err << std::endl;
+        releaseDeviceGraph(dev);
         return false;
     }
 
-    cl_mem parent_buf = clCreateBuffer(ctx.context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR,
-                                       sizeof(int) * parent.size(), parent.data(), &err);
-    if (err != CL_SUCCESS)
+    dev.push = clCreateKernel(ctx.program, "relax_push", &err);
+    if (err == CL_SUCCESS)
+        dev.pull = clCreateKernel(ctx.program, "relax_pull", &err);
+    if (err == CL_SUCCESS)
+        dev.compact = clCreateKernel(ctx.program, "compact_frontier", &err);
+    if (err == CL_SUCCESS)
+        dev.seed = clCreateKernel(ctx.program, "seed_frontier", &err);
+    if (err == CL_SUCCESS)
+        dev.seed_invalid = clCreateKernel(ctx.program, "seed_invalid", &err);
+    if (err == CL_SUCCESS)
+        dev.deletions = clCreateKernel(ctx.program, "apply_deletions", &err);
+    if (err == CL_SUCCESS)
+        dev.insertions = clCreateKernel(ctx.program, "apply_insertions", &err);
+    if (err == CL_SUCCESS)
+        dev.invalidate = clCreateKernel(ctx.program, "invalidate_children", &err);
+    if (!checkCL(err, "create kernels"))
     {
-        std::cerr << "Failed to create parent buffer: " << err << std::endl;
-        clReleaseMemObject(dist_buf);
+        releaseDeviceGraph(dev);
         return false;
     }
 
-    // Create a flattened array of edge indices for OpenCL
-    std::vector<cl_int2> cl_edges(num_edges);
-    for (size_t i = 0; i < num_edges; i++)
+    // Arguments that stay the same for every round
+    err = clSetKernelArg(dev.push, 0, sizeof(cl_mem), &dev.dist);
+    err |= clSetKernelArg(dev.push, 1, sizeof(cl_mem), &dev.offsets);
+    err |= clSetKernelArg(dev.push, 2, sizeof(cl_mem), &dev.targets);
+    err |= clSetKernelArg(dev.push, 3, sizeof(cl_mem), &dev.weights);
+    err |= clSetKernelArg(dev.push, 4, sizeof(cl_mem), &dev.owner);
+    err |= clSetKernelArg(dev.push, 5, sizeof(int), &dev.index);
+    err |= clSetKernelArg(dev.push, 6, sizeof(cl_mem), &dev.frontier);
+    err |= clSetKernelArg(dev.push, 8, sizeof(cl_mem), &dev.flags);
+
+    err |= clSetKernelArg(dev.pull, 0, sizeof(cl_mem), &dev.dist);
+    err |= clSetKernelArg(dev.pull, 1, sizeof(cl_mem), &dev.offsets);
+    err |= clSetKernelArg(dev.pull, 2, sizeof(cl_mem), &dev.targets);
+    err |= clSetKernelArg(dev.pull, 3, sizeof(cl_mem), &dev.weights);
+    err |= clSetKernelArg(dev.pull, 4, sizeof(cl_mem), &dev.local_vertices);
+    err |= clSetKernelArg(dev.pull, 5, sizeof(cl_uint), &dev.num_local);
+    err |= clSetKernelArg(dev.pull, 6, sizeof(cl_mem), &dev.flags);
+
+    err |= clSetKernelArg(dev.compact, 0, sizeof(cl_mem), &dev.flags);
+    err |= clSetKernelArg(dev.compact, 1, sizeof(cl_mem), &dev.dist);
+    err |= clSetKernelArg(dev.compact, 2, sizeof(cl_mem), &dev.offsets);
+    err |= clSetKernelArg(dev.compact, 3, sizeof(cl_mem), &dev.frontier);
+    err |= clSetKernelArg(dev.compact, 4, sizeof(cl_mem), &dev.frontier_dist);
+    err |= clSetKernelArg(dev.compact, 5, sizeof(cl_mem), &dev.counters);
+    err |= clSetKernelArg(dev.compact, 6, sizeof(cl_uint), &dev.num_vertices);
+
+    err |= clSetKernelArg(dev.seed, 0, sizeof(cl_mem), &dev.dist);
+    err |= clSetKernelArg(dev.seed, 1, sizeof(cl_mem), &dev.flags);
+    err |= clSetKernelArg(dev.seed_invalid, 0, sizeof(cl_mem), &dev.dist);
+    err |= clSetKernelArg(dev.seed_invalid, 1, sizeof(cl_mem), &dev.flags);
+
+    err |= clSetKernelArg(dev.deletions, 0, sizeof(cl_mem), &dev.dist);
+    err |= clSetKernelArg(dev.deletions, 1, sizeof(cl_mem), &dev.parent);
+    err |= clSetKernelArg(dev.deletions, 2, sizeof(cl_mem), &dev.owner);
+    err |= clSetKernelArg(dev.deletions, 3, sizeof(int), &dev.index);
+    err |= clSetKernelArg(dev.deletions, 7, sizeof(cl_mem), &dev.flags);
+
+    err |= clSetKernelArg(dev.insertions, 0, sizeof(cl_mem), &dev.dist);
+    err |= clSetKernelArg(dev.insertions, 1, sizeof(cl_mem), &dev.owner);
+    err |= clSetKernelArg(dev.insertions, 2, sizeof(int), &dev.index);
+    err |= clSetKernelArg(dev.insertions, 7, sizeof(cl_mem), &dev.flags);
+
+    err |= clSetKernelArg(dev.invalidate, 0, sizeof(cl_mem), &dev.dist);
+    err |= clSetKernelArg(dev.invalidate, 1, sizeof(cl_mem), &dev.parent);
+    err |= clSetKernelArg(dev.invalidate, 2, sizeof(cl_mem), &dev.offsets);
+    err |= clSetKernelArg(dev.invalidate, 3, sizeof(cl_mem), &dev.targets);
+    err |= clSetKernelArg(dev.invalidate, 4, sizeof(cl_mem), &dev.owner);
+    err |= clSetKernelArg(dev.invalidate, 5, sizeof(int), &dev.index);
+    err |= clSetKernelArg(dev.invalidate, 6, sizeof(cl_mem), &dev.frontier);
+    err |= clSetKernelArg(dev.invalidate, 8, sizeof(cl_mem), &dev.flags);
+    if (!checkCL(err, "set kernel arguments"))
     {
-        cl_edges[i].s[0] = edges[i].first;
-        cl_edges[i].s[1] = edges[i].second;
+        releaseDeviceGraph(dev);
+        return false;
     }
 
-    cl_mem edges_buf = clCreateBuffer(ctx.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
-                                      sizeof(cl_int2) * num_edges, const_cast<void *>(static_cast<const void *>(edges.data())), &err);
-    if (err != CL_SUCCESS)
+    cl_uchar zero = 0;
+    if (!checkCL(clEnqueueFillBuffer(dev.queue, dev.flags, &zero, 1, 0, dev.num_vertices, 0, NULL, NULL), "clear flags"))
     {
-        std::cerr << "Failed to create edges buffer: " << err << std::endl;
-        clReleaseMemObject(dist_buf);
-        clReleaseMemObject(parent_buf);
+        releaseDeviceGraph(dev);
         return false;
     }
-
-    cl_mem weights_buf = clCreateBuffer(ctx.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
-                                        sizeof(float) * num_edges, const_cast<void *>(static_cast<const void *>(weights.data())), &err);
-    if (err != CL_SUCCESS)
+    if (!mapHostArrays(dev))
     {
-        std::cerr << "Failed to create weights buffer: " << err << std::endl;
-        clReleaseMemObject(dist_buf);
-        clReleaseMemObject(parent_buf);
-        clReleaseMemObject(edges_buf);
+        releaseDeviceGraph(dev);
         return false;
     }
+    return true;
+}
 
-    cl_kernel kernel = clCreateKernel(ctx.program, "relax_edges", &err);
-    if (err != CL_SUCCESS)
+void releaseDeviceGraph(DeviceGraph &dev)
+{
+    // Shared arrays go back to the host for good
+    if (dev.mapped_dist)
     {
-        std::cerr << "Failed to create kernel: " << err << std::endl;
-        clReleaseMemObject(dist_buf);
-        clReleaseMemObject(parent_buf);
-        clReleaseMemObject(edges_buf);
-        clReleaseMemObject(weights_buf);
-        return false;
+        unmapHostArrays(dev);
+        clFinish(dev.queue);
     }
+    dev.zero_copy = false;
+    for (cl_kernel *kernel : {&dev.push, &dev.pull, &dev.compact, &dev.seed, &dev.seed_invalid,
+                              &dev.deletions, &dev.insertions, &dev.invalidate})
+    {
+        if (*kernel)
+            clReleaseKernel(*kernel);
+        *kernel = nullptr;
+    }
+    if (dev.relax_event)
+        clReleaseEvent(dev.relax_event);
+    dev.relax_event = nullptr;
+    for (cl_mem *buf : {&dev.offsets, &dev.targets, &dev.weights, &dev.owner, &dev.local_vertices,
+                        &dev.dist, &dev.parent, &dev.flags, &dev.frontier, &dev.frontier_dist, &dev.counters,
+                        &dev.seed_ids, &dev.seed_dist, &dev.batch_ends, &dev.batch_weights})
+    {
+        if (*buf)
+            clReleaseMemObject(*buf);
+        *buf = nullptr;
+    }
+    dev.seed_capacity = dev.batch_capacity = 0;
+}
 
-    // Set kernel args
-    err = clSetKernelArg(kernel, 0, sizeof(cl_mem), &dist_buf);
-    err |= clSetKernelArg(kernel, 1, sizeof(cl_mem), &parent_buf);
-    err |= clSetKernelArg(kernel, 2, sizeof(cl_mem), &edges_buf);
-    err |= clSetKernelArg(kernel, 3, sizeof(cl_mem), &weights_buf);
-    err |= clSetKernelArg(kernel, 4, sizeof(int), &num_edges);
+// Staging buffers grow to the largest seed set seen
+static bool reserveSeeds(OpenCLContext &ctx, DeviceGraph &dev, size_t count)
+{
+    if (count <= dev.seed_capacity)
+        return true;
 
-    if (err != CL_SUCCESS)
+    for (cl_mem *buf : {&dev.seed_ids, &dev.seed_dist})
     {
-        std::cerr << "Failed to set kernel arguments: " << err << std::endl;
-        clReleaseKernel(kernel);
-        clReleaseMemObject(dist_buf);
-        clReleaseMemObject(parent_buf);
-        clReleaseMemObject(edges_buf);
-        clReleaseMemObject(weights_buf);
-        return false;
+        if (*buf)
+            clReleaseMemObject(*buf);
+        *buf = nullptr;
     }
+    dev.seed_capacity = 0;
+    cl_int err;
+    dev.seed_ids = clCreateBuffer(ctx.context, CL_MEM_READ_ONLY, sizeof(cl_int) * count, NULL, &err);
+    if (err == CL_SUCCESS)
+        dev.seed_dist = clCreateBuffer(ctx.context, CL_MEM_READ_ONLY, sizeof(float) * count, NULL, &err);
+    if (!checkCL(err, "create seed buffers"))
+        return false;
+    dev.seed_capacity = count;
+    return true;
+}
+
+bool seedFrontier(OpenCLContext &ctx, DeviceGraph &dev,
+                  const std::vector<cl_int> &ids, const std::vector<float> &values)
+{
+    cl_uint count = ids.size();
+    if (count == 0)
+        return true;
+    if (!reserveSeeds(ctx, dev, count))
+        return false;
 
-    // Ensure global_size is multiple of local_size
-    global_size = ((global_size + local_size - 1) / local_size) * local_size;
+    cl_int err = clEnqueueWriteBuffer(dev.queue, dev.seed_ids, CL_FALSE, 0, sizeof(cl_int) * count, ids.data(), 0, NULL, NULL);
+    err |= clEnqueueWriteBuffer(dev.queue, dev.seed_dist, CL_FALSE, 0, sizeof(float) * count, values.data(), 0, NULL, NULL);
+    err |= clSetKernelArg(dev.seed, 2, sizeof(cl_mem), &dev.seed_ids);
+    err |= clSetKernelArg(dev.seed, 3, sizeof(cl_mem), &dev.seed_dist);
+    err |= clSetKernelArg(dev.seed, 4, sizeof(cl_uint), &count);
+    if (!checkCL(err, "write seeds"))
+        return false;
+    // The writes are non-blocking, so wait before the caller reuses ids
+    return launch(ctx, dev, dev.seed, count, "launch seed kernel") &&
+           finish(dev, "wait for seed kernel");
+}
 
-    err = clEnqueueNDRangeKernel(ctx.queue, kernel, 1, NULL, &global_size, &local_size, 0, NULL, NULL);
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Failed to launch kernel: " << err << std::endl;
-        clReleaseKernel(kernel);
-        clReleaseMemObject(dist_buf);
-        clReleaseMemObject(parent_buf);
-        clReleaseMemObject(edges_buf);
-        clReleaseMemObject(weights_buf);
+bool seedInvalid(OpenCLContext &ctx, DeviceGraph &dev, const std::vector<cl_int> &ids)
+{
+    cl_uint count = ids.size();
+    if (count == 0)
+        return true;
+    if (!reserveSeeds(ctx, dev, count))
         return false;
-    }
 
-    // Wait for kernel to complete
-    err = clFinish(ctx.queue);
-    if (err != CL_SUCCESS)
-    {
-        std::cerr << "Error waiting for kernel completion: " << err << std::endl;
-        clReleaseKernel(kernel);
-        clReleaseMemObject(dist_buf);
-        clReleaseMemObject(parent_buf);
-        clReleaseMemObject(edges_buf);
-        clReleaseMemObject(weights_buf);
+    cl_int err = clEnqueueWriteBuffer(dev.queue, dev.seed_ids, CL_FALSE, 0, sizeof(cl_int) * count, ids.data(), 0, NULL, NULL);
+    err |= clSetKernelArg(dev.seed_invalid, 2, sizeof(cl_mem), &dev.seed_ids);
+    err |= clSetKernelArg(dev.seed_invalid, 3, sizeof(cl_uint), &count);
+    if (!checkCL(err, "write invalidations"))
         return false;
-    }
+    return launch(ctx, dev, dev.seed_invalid, count, "launch invalidation seed kernel") &&
+           finish(dev, "wait for invalidation seed kernel");
+}
 
-    // Read back results
-    err = clEnqueueReadBuffer(ctx.queue, dist_buf, CL_TRUE, 0, sizeof(float) * dist.size(), dist.data(), 0, NULL, NULL);
-    if (err != CL_SUCCESS)
+bool applyBatch(OpenCLContext &ctx, DeviceGraph &dev, const std::vector<cl_int> &ends,
+                const std::vector<float> &weights, cl_uint num_deletes)
+{
+    cl_uint count = weights.size();
+    if (count == 0)
+        return true;
+
+    if (count > dev.batch_capacity)
     {
-        std::cerr << "Failed to read dist buffer: " << err << std::endl;
-        clReleaseKernel(kernel);
-        clReleaseMemObject(dist_buf);
-        clReleaseMemObject(parent_buf);
-        clReleaseMemObject(edges_buf);
-        clReleaseMemObject(weights_buf);
+        for (cl_mem *buf : {&dev.batch_ends, &dev.batch_weights})
+        {
+            if (*buf)
+                clReleaseMemObject(*buf);
+            *buf = nullptr;
+        }
+        dev.batch_capacity = 0;
+        cl_int err;
+        dev.batch_ends = clCreateBuffer(ctx.context, CL_MEM_READ_ONLY, 2 * sizeof(cl_int) * count, NULL, &err);
+        if (err == CL_SUCCESS)
+            dev.batch_weights = clCreateBuffer(ctx.context, CL_MEM_READ_ONLY, sizeof(float) * count, NULL, &err);
+        if (!checkCL(err, "create batch buffers"))
+            return false;
+        dev.batch_capacity = count;
+    }
+
+    cl_uint first = 0;
+    cl_int err = clEnqueueWriteBuffer(dev.queue, dev.batch_ends, CL_FALSE, 0, 2 * sizeof(cl_int) * count, ends.data(), 0, NULL, NULL);
+    err |= clEnqueueWriteBuffer(dev.queue, dev.batch_weights, CL_FALSE, 0, sizeof(float) * count, weights.data(), 0, NULL, NULL);
+    err |= clSetKernelArg(dev.deletions, 4, sizeof(cl_mem), &dev.batch_ends);
+    err |= clSetKernelArg(dev.deletions, 5, sizeof(cl_uint), &first);
+    err |= clSetKernelArg(dev.deletions, 6, sizeof(cl_uint), &num_deletes);
+    err |= clSetKernelArg(dev.insertions, 3, sizeof(cl_mem), &dev.batch_ends);
+    err |= clSetKernelArg(dev.insertions, 4, sizeof(cl_mem), &dev.batch_weights);
+    if (!checkCL(err, "write update batch"))
         return false;
+
+    // The wait keeps ends and weights alive for the non-blocking writes
+    return launch(ctx, dev, dev.deletions, num_deletes, "launch deletion kernel") &&
+           finish(dev, "wait for update batch");
+}
+
+bool applyInsertions(OpenCLContext &ctx, DeviceGraph &dev, cl_uint first, cl_uint count)
+{
+    if (count == 0)
+        return true;
+    cl_int err = clSetKernelArg(dev.insertions, 5, sizeof(cl_uint), &first);
+    err |= clSetKernelArg(dev.insertions, 6, sizeof(cl_uint), &count);
+    return checkCL(err, "set insertion arguments") &&
+           launch(ctx, dev, dev.insertions, count, "launch insertion kernel") &&
+           flush(dev);
+}
+
+bool pullVertices(OpenCLContext &ctx, DeviceGraph &dev, const std::vector<cl_int> &ids)
+{
+    cl_uint count = ids.size();
+    if (count == 0)
+        return true;
+    if (!reserveSeeds(ctx, dev, count))
+        return false;
+
+    // The pull kernel runs over the staged list instead of every local
+    // vertex, then gets its usual list back
+    cl_int err = clEnqueueWriteBuffer(dev.queue, dev.seed_ids, CL_FALSE, 0, sizeof(cl_int) * count, ids.data(), 0, NULL, NULL);
+    err |= clSetKernelArg(dev.pull, 4, sizeof(cl_mem), &dev.seed_ids);
+    err |= clSetKernelArg(dev.pull, 5, sizeof(cl_uint), &count);
+    bool ok = checkCL(err, "stage pull list") && launch(ctx, dev, dev.pull, count, "launch pull kernel") &&
+              finish(dev, "wait for pull kernel");
+    err = clSetKernelArg(dev.pull, 4, sizeof(cl_mem), &dev.local_vertices);
+    err |= clSetKernelArg(dev.pull, 5, sizeof(cl_uint), &dev.num_local);
+    return checkCL(err, "restore pull arguments") && ok;
+}
+
+bool compactFrontier(OpenCLContext &ctx, DeviceGraph &dev,
+                     std::vector<cl_int> &ids, std::vector<float> &values, cl_uint &edges)
+{
+    cl_uint counters[2] = {0, 0};
+    if (!checkCL(clEnqueueWriteBuffer(dev.queue, dev.counters, CL_FALSE, 0, sizeof(counters), counters, 0, NULL, NULL), "reset counters") ||
+        !launch(ctx, dev, dev.compact, dev.num_vertices, "launch compaction kernel") ||
+        !checkCL(clEnqueueReadBuffer(dev.queue, dev.counters, CL_TRUE, 0, sizeof(counters), counters, 0, NULL, NULL), "read counters"))
+        return false;
+
+    // The queue is in order, so the last relaxation has finished too
+    if (dev.relax_event)
+    {
+        cl_ulong start = 0, end = 0;
+        clGetEventProfilingInfo(dev.relax_event, CL_PROFILING_COMMAND_START, sizeof(start), &start, NULL);
+        clGetEventProfilingInfo(dev.relax_event, CL_PROFILING_COMMAND_END, sizeof(end), &end, NULL);
+        if (end > start)
+        {
+            dev.busy_seconds += (end - start) * 1e-9;
+            dev.relaxed_edges += dev.relax_edges;
+        }
+        clReleaseEvent(dev.relax_event);
+        dev.relax_event = nullptr;
     }
 
-    err = clEnqueueReadBuffer(ctx.queue, parent_buf, CL_TRUE, 0, sizeof(int) * parent.size(), parent.data(), 0, NULL, NULL);
-    if (err != CL_SUCCESS)
+    ids.resize(counters[0]);
+    values.resize(counters[0]);
+    edges = counters[1];
+    if (counters[0] > 0)
     {
-        std::cerr << "Failed to read parent buffer: " << err << std::endl;
-        clReleaseKernel(kernel);
-        clReleaseMemObject(dist_buf);
-        clReleaseMemObject(parent_buf);
-        clReleaseMemObject(edges_buf);
-        clReleaseMemObject(weights_buf);
-        return false;
+        cl_int err = clEnqueueReadBuffer(dev.queue, dev.frontier, CL_FALSE, 0, sizeof(cl_int) * ids.size(), ids.data(), 0, NULL, NULL);
+        err |= clEnqueueReadBuffer(dev.queue, dev.frontier_dist, CL_TRUE, 0, sizeof(float) * values.size(), values.data(), 0, NULL, NULL);
+        if (!checkCL(err, "read frontier"))
+            return false;
     }
+    return mapHostArrays(dev);
+}
 
-    // Cleanup
-    clReleaseKernel(kernel);
-    clReleaseMemObject(dist_buf);
-    clReleaseMemObject(parent_buf);
-    clReleaseMemObject(edges_buf);
-    clReleaseMemObject(weights_buf);
+bool relaxFrontier(OpenCLContext &ctx, DeviceGraph &dev, bool pull, cl_uint frontier_size, cl_uint frontier_edges)
+{
+    // Flushed so every device starts while the host turns to the next one
+    bool ok;
+    if (pull)
+    {
+        dev.relax_edges = dev.local_edges;
+        ok = launch(ctx, dev, dev.pull, dev.num_local, "launch pull kernel", &dev.relax_event);
+    }
+    else
+    {
+        dev.relax_edges = frontier_edges;
+        ok = checkCL(clSetKernelArg(dev.push, 7, sizeof(cl_uint), &frontier_size), "set push arguments") &&
+             launch(ctx, dev, dev.push, frontier_size, "launch push kernel", &dev.relax_event);
+    }
+    return ok && flush(dev);
+}
 
-    return success;
-}
\ No newline at end of file
+bool invalidateFrontier(OpenCLContext &ctx, DeviceGraph &dev, cl_uint frontier_size)
+{
+    return checkCL(clSetKernelArg(dev.invalidate, 7, sizeof(cl_uint), &frontier_size), "set invalidation arguments") &&
+           launch(ctx, dev, dev.invalidate, frontier_size, "launch invalidation kernel") &&
+           flush(dev);
+}
@@ -1,25 +1,139 @@
 #ifndef OPENCL_UTILS_H
 #define OPENCL_UTILS_H
 
+#include "numa_utils.h"
 #include <CL/cl.h>
 #include <vector>
 #include <string>
 
 struct OpenCLContext
 {
-    cl_platform_id platform;
+    cl_platform_id platform = nullptr;
     std::vector<cl_device_id> devices;
-    cl_context context;
-    cl_program program;
-    cl_command_queue queue;
+    cl_context context = nullptr;
+    cl_program program = nullptr;
+    std::vector<cl_command_queue> queues; // One per device
+
+    size_t work_group_size = 64; // Compiled into the kernels, see KernelConfig
+
+    // A single device sharing the host's memory (a CPU device or an
+    // integrated GPU): buffers wrap the host arrays instead of copying them,
+    // provided those start on a host_align boundary. SSSP_CL_ZERO_COPY=off
+    // turns it off.
+    bool zero_copy = false;
+    size_t host_align = 1;
+};
+
+// What relax_edges.cl is specialised for with -D options when the program
+// is built. Each combination is a separate entry in the binary cache.
+struct KernelConfig
+{
+    // Work-group size the kernels require; lowered to the device limit.
+    // SSSP_CL_WG=<n> in the environment overrides it.
+    size_t work_group_size = 64;
+
+    // atomic_min on the bit pattern of the distance, which orders like the
+    // float only while distances are non-negative; otherwise a
+    // compare-and-swap loop. SSSP_CL_ATOMIC=cas forces the loop.
+    bool int_atomics = true;
+};
+
+// Device copy of a rank's graph for the relaxation rounds of Step 2: CSR
+// adjacency (32-bit vertex IDs and offsets), owners, distances and the
+// frontier. With several devices the rank's vertices are split between
+// them: owner holds the device index of every local vertex (-1 for the
+// rest), and a device only writes the vertices it owns. Everything else is
+// a ghost whose distance the host hands in.
+//
+// With zero_copy the dist and parent buffers are the host arrays uploadGraph
+// was given. The host may only touch them while they are mapped and kernels
+// only run while they are not: every call below unmaps before it queues a
+// kernel and hands the arrays back mapped when it returns. Mapping a buffer
+// over host memory returns that memory, so this costs no copies.
+struct DeviceGraph
+{
+    int index = 0;
+    bool zero_copy = false;
+    void *mapped_dist = nullptr, *mapped_parent = nullptr;
+    cl_command_queue queue = nullptr;
+    cl_uint num_vertices = 0;
+    cl_uint num_local = 0;
+    cl_ulong local_edges = 0;
+    cl_mem offsets = nullptr, targets = nullptr, weights = nullptr;
+    cl_mem owner = nullptr, local_vertices = nullptr;
+    cl_mem dist = nullptr, parent = nullptr, flags = nullptr;
+    cl_mem frontier = nullptr, frontier_dist = nullptr, counters = nullptr;
+    cl_mem seed_ids = nullptr, seed_dist = nullptr;
+    size_t seed_capacity = 0;
+    cl_mem batch_ends = nullptr, batch_weights = nullptr;
+    size_t batch_capacity = 0;
+    cl_kernel push = nullptr, pull = nullptr, compact = nullptr, seed = nullptr, seed_invalid = nullptr;
+    cl_kernel deletions = nullptr, insertions = nullptr, invalidate = nullptr;
+
+    // Kernel time of the relaxation rounds since the upload, for weighting
+    // the next split
+    cl_event relax_event = nullptr;
+    cl_ulong relax_edges = 0;
+    double relaxed_edges = 0;
+    double busy_seconds = 0;
 };
 
-bool setupOpenCL(OpenCLContext &ctx, const std::string &kernel_file);
+// Creates the context and builds the kernels for config. The source is
+// compiled into the executable (SSSP_CL_SOURCE=<file> builds another one
+// instead), and program binaries are cached per device and source under
+// $SSSP_CL_CACHE, else $XDG_CACHE_HOME/dynsssp or ~/.cache/dynsssp;
+// SSSP_CL_CACHE=off always builds from source.
+bool setupOpenCL(OpenCLContext &ctx, const KernelConfig &config);
 void cleanupOpenCL(OpenCLContext &ctx);
-bool runRelaxationKernel(OpenCLContext &ctx,
-                         std::vector<float> &dist,
-                         std::vector<int> &parent,
-                         const std::vector<std::pair<int, int>> &edges,
-                         const std::vector<float> &weights);
+
+// Copies graph, distances and parents to device index of the context, or
+// wraps them when the context is zero-copy, replacing what was there;
+// local_vertices are the ones owner assigns to it
+bool uploadGraph(OpenCLContext &ctx, DeviceGraph &dev, int index,
+                 const placed_vector<cl_uint> &offsets,
+                 const placed_vector<cl_int> &targets,
+                 const placed_vector<float> &weights,
+                 const std::vector<cl_int> &local_vertices,
+                 const placed_vector<cl_int> &owner,
+                 placed_vector<cl_int> &parent,
+                 placed_vector<float> &dist);
+void releaseDeviceGraph(DeviceGraph &dev);
+
+// Lowers the given distances on the device and adds the vertices to the
+// next frontier
+bool seedFrontier(OpenCLContext &ctx, DeviceGraph &dev,
+                  const std::vector<cl_int> &ids, const std::vector<float> &values);
+
+// Step 1 on the device: copies the batch over, the first num_deletes updates
+// (endpoints at 2i and 2i + 1 of ends) being deletions, and applies those.
+// Vertices they cut off are flagged for the next compactFrontier.
+bool applyBatch(OpenCLContext &ctx, DeviceGraph &dev, const std::vector<cl_int> &ends,
+                const std::vector<float> &weights, cl_uint num_deletes);
+
+// Applies the insertions of the batch, once Phase 1 is done; improved
+// vertices are flagged
+bool applyInsertions(OpenCLContext &ctx, DeviceGraph &dev, cl_uint first, cl_uint count);
+
+// Marks the given vertices invalid (infinite distance) and adds them to the
+// next frontier
+bool seedInvalid(OpenCLContext &ctx, DeviceGraph &dev, const std::vector<cl_int> &ids);
+
+// Invalidates the owned children of every invalid vertex in the compacted
+// frontier; like relaxFrontier it only queues the work
+bool invalidateFrontier(OpenCLContext &ctx, DeviceGraph &dev, cl_uint frontier_size);
+
+// A pull round over the given owned vertices only
+bool pullVertices(OpenCLContext &ctx, DeviceGraph &dev, const std::vector<cl_int> &ids);
+
+// Collects the vertices improved since the last call into the device
+// frontier and returns them with their distances and total degree
+bool compactFrontier(OpenCLContext &ctx, DeviceGraph &dev,
+                     std::vector<cl_int> &ids, std::vector<float> &values, cl_uint &edges);
+
+// One push round over the compacted frontier, or one pull round over every
+// vertex the device owns. Returns once the round is queued, or with
+// zero_copy once it is done; the next seedFrontier or compactFrontier waits
+// for it.
+bool relaxFrontier(OpenCLContext &ctx, DeviceGraph &dev, bool pull, cl_uint frontier_size, cl_uint frontier_edges);
 
 #endif // OPENCL_UTILS_H
\ No newline at end of file
@@ -1,56 +1,222 @@
-// Optimized kernel for edge relaxation in SSSP
+// An update batch on the rank's graph in CSR form: Step 1, the subtree
+// invalidation of Phase 1, and the relaxation rounds of Step 2. A round
+// either pushes from the frontier or pulls into every local vertex; the
+// vertices a kernel changes are flagged and compacted into the next frontier.
 
 #define INF INFINITY
 
-__kernel void relax_edges(__global float *dist, __global int *parent,
-                          __global int2 *edges, __global float *weights,
-                          const int num_edges)
+// Specialisation, set by setupOpenCL with -D options: the work-group size
+// every launch uses, the element type of the weights buffer, and whether
+// atomic_min_float may use integer atomic_min
+#ifndef WG_SIZE
+#define WG_SIZE 64
+#endif
+#ifndef WEIGHT_T
+#define WEIGHT_T float
+#endif
+#ifndef ATOMIC_INT_MIN
+#define ATOMIC_INT_MIN 0
+#endif
+
+#define KERNEL __kernel __attribute__((reqd_work_group_size(WG_SIZE, 1, 1)))
+
+// Atomic min for floats, which OpenCL doesn't provide natively; returns the
+// value it replaced
+inline float atomic_min_float(volatile __global float *addr, float val)
 {
-    int i = get_global_id(0);
-    if (i >= num_edges)
-        return;
+#if ATOMIC_INT_MIN
+    // Non-negative floats, infinity included, order like their bit patterns
+    // read as signed integers, so one atomic_min does it
+    return as_float(atomic_min((volatile __global int *)addr, as_int(val)));
+#else
+    union
+    {
+        float f;
+        unsigned int i;
+    } old_val, new_val;
 
-    // Local variables for better performance
-    int u = edges[i].x;
-    int v = edges[i].y;
-    float w = weights[i];
-    float dist_u = dist[u];
-    float dist_v = dist[v];
+    do
+    {
+        old_val.f = *addr;
+        if (old_val.f <= val)
+            return old_val.f;
+        new_val.f = val;
+    } while (atomic_cmpxchg((volatile __global unsigned int *)addr,
+                            old_val.i, new_val.i) != old_val.i);
+    return old_val.f;
+#endif
+}
 
-    // Check for infinities
-    if (dist_u == INF)
+// Step 1 for deletions: a deleted tree edge cuts the child off. ends holds
+// the endpoints of each update, (u, v) at 2i and 2i + 1.
+KERNEL void apply_deletions(__global float *dist, __global int *parent,
+                            __global const int *owner, const int self,
+                            __global const int *ends, const uint first, const uint count,
+                            __global uchar *flags)
+{
+    uint i = get_global_id(0);
+    if (i >= count)
         return;
 
-    // Calculate potential new distance
-    float new_dist = dist_u + w;
+    int u = ends[2 * (first + i)], v = ends[2 * (first + i) + 1];
+    if (owner[v] == self && parent[v] == u)
+    {
+        dist[v] = INF;
+        parent[v] = -1;
+        flags[v] = 1;
+    }
+    if (owner[u] == self && parent[u] == v)
+    {
+        dist[u] = INF;
+        parent[u] = -1;
+        flags[u] = 1;
+    }
+}
 
-    // Perform relaxation if better path found
-    if (new_dist < dist_v)
+// Step 1 for insertions: the farther endpoint takes the shorter route. On
+// the device this runs once Phase 1 is done, so nothing links into a
+// subtree that is about to be invalidated, and the host settles the parents.
+KERNEL void apply_insertions(__global float *dist, __global const int *owner, const int self,
+                             __global const int *ends, __global const WEIGHT_T *batch_weights,
+                             const uint first, const uint count, __global uchar *flags)
+{
+    uint i = get_global_id(0);
+    if (i >= count)
+        return;
+
+    int u = ends[2 * (first + i)], v = ends[2 * (first + i) + 1];
+    if (dist[u] > dist[v])
     {
-        // Use atomic operation for thread safety
-        atomic_min_float(&dist[v], new_dist);
+        int t = u;
+        u = v;
+        v = t;
+    }
+    float new_dist = dist[u] + batch_weights[first + i];
+    if (owner[v] == self && new_dist < atomic_min_float(&dist[v], new_dist))
+        flags[v] = 1;
+}
 
-        // Check if we actually updated the distance before changing parent
-        if (dist[v] == new_dist)
+// Phase 1 of Step 2: the children this device owns of every invalidated
+// frontier vertex are invalidated in turn. A vertex has a single parent, so
+// no two work-items write the same child.
+KERNEL void invalidate_children(__global float *dist, __global int *parent,
+                                __global const uint *offsets, __global const int *targets,
+                                __global const int *owner, const int self,
+                                __global const int *frontier, const uint frontier_size,
+                                __global uchar *flags)
+{
+    uint i = get_global_id(0);
+    if (i >= frontier_size)
+        return;
+
+    int v = frontier[i];
+    if (dist[v] != INF)
+        return;
+
+    for (uint e = offsets[v]; e < offsets[v + 1]; e++)
+    {
+        int c = targets[e];
+        if (owner[c] == self && parent[c] == v)
         {
-            parent[v] = u;
+            dist[c] = INF;
+            parent[c] = -1;
+            flags[c] = 1;
         }
     }
 }
 
-// Custom atomic min operation for floats since OpenCL doesn't provide it natively
-inline void atomic_min_float(__global float *addr, float val)
+// Push: each frontier vertex relaxes its edges into the neighbours this
+// device owns (owner[v] == self). Several work-items can lower the same
+// vertex, hence the atomic.
+KERNEL void relax_push(__global float *dist, __global const uint *offsets,
+                       __global const int *targets, __global const WEIGHT_T *weights,
+                       __global const int *owner, const int self,
+                       __global const int *frontier, const uint frontier_size,
+                       __global uchar *flags)
 {
-    union
+    uint i = get_global_id(0);
+    if (i >= frontier_size)
+        return;
+
+    int u = frontier[i];
+    float dist_u = dist[u];
+    if (dist_u == INF)
+        return;
+
+    for (uint e = offsets[u]; e < offsets[u + 1]; e++)
     {
-        float f;
-        unsigned int i;
-    } old_val, new_val;
+        int v = targets[e];
+        float new_dist = dist_u + weights[e];
+        if (owner[v] == self && new_dist < dist[v] &&
+            new_dist < atomic_min_float(&dist[v], new_dist))
+            flags[v] = 1;
+    }
+}
 
-    do
+// Pull: each vertex the device owns takes the minimum over its neighbours.
+// Only the vertex's own work-item writes it, so no atomics are needed.
+KERNEL void relax_pull(__global float *dist, __global const uint *offsets,
+                       __global const int *targets, __global const WEIGHT_T *weights,
+                       __global const int *local_vertices, const uint num_local,
+                       __global uchar *flags)
+{
+    uint i = get_global_id(0);
+    if (i >= num_local)
+        return;
+
+    int v = local_vertices[i];
+    float best = dist[v];
+    for (uint e = offsets[v]; e < offsets[v + 1]; e++)
+        best = fmin(best, dist[targets[e]] + weights[e]);
+
+    if (best < dist[v])
     {
-        old_val.f = *addr;
-        new_val.f = (val < old_val.f) ? val : old_val.f;
-    } while (atomic_cmpxchg((volatile __global unsigned int *)addr,
-                            old_val.i, new_val.i) != old_val.i);
-}
\ No newline at end of file
+        dist[v] = best;
+        flags[v] = 1;
+    }
+}
+
+// Moves flagged vertices into the frontier, with their distances for the
+// host. counters[0] counts them, counters[1] sums their degrees.
+KERNEL void compact_frontier(__global uchar *flags, __global const float *dist,
+                             __global const uint *offsets, __global int *frontier,
+                             __global float *frontier_dist, __global uint *counters,
+                             const uint num_vertices)
+{
+    uint v = get_global_id(0);
+    if (v >= num_vertices || !flags[v])
+        return;
+
+    flags[v] = 0;
+    uint slot = atomic_inc(&counters[0]);
+    frontier[slot] = v;
+    frontier_dist[slot] = dist[v];
+    atomic_add(&counters[1], offsets[v + 1] - offsets[v]);
+}
+
+// Applies distances from the host (seeds and ghost updates) and flags them
+// for the next frontier
+KERNEL void seed_frontier(__global float *dist, __global uchar *flags,
+                          __global const int *ids, __global const float *values,
+                          const uint count)
+{
+    uint i = get_global_id(0);
+    if (i >= count)
+        return;
+
+    atomic_min_float(&dist[ids[i]], values[i]);
+    flags[ids[i]] = 1;
+}
+
+// Invalidations from other devices and ranks: unlike a distance they raise
+// the value, so they are stored rather than merged
+KERNEL void seed_invalid(__global float *dist, __global uchar *flags,
+                         __global const int *ids, const uint count)
+{
+    uint i = get_global_id(0);
+    if (i >= count)
+        return;
+
+    dist[ids[i]] = INF;
+    flags[ids[i]] = 1;
+}
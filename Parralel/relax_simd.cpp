@@ -0,0 +1,320 @@
+#include "relax_simd.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SSSP_X86 1
+#endif
+
+// Inlined into every kernel, so the tail is compiled for the kernel's
+// instruction set; calling plain SSE code from AVX code stalls on the
+// state transition
+static inline __attribute__((always_inline)) size_t relaxTail(const std::pair<vertex_t, float> *list, size_t count, float d,
+                                                              const float *dist, const int *part, int rank,
+                                                              vertex_t *out_vertex, float *out_dist)
+{
+    size_t found = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        vertex_t v = list[i].first;
+        float new_dist = d + list[i].second;
+        if (new_dist < dist[v] && (!part || part[v] == rank))
+        {
+            out_vertex[found] = v;
+            out_dist[found] = new_dist;
+            found++;
+        }
+    }
+    return found;
+}
+
+static size_t relaxScalar(const std::pair<vertex_t, float> *list, size_t count, float d,
+                          const float *dist, const int *part, int rank,
+                          vertex_t *out_vertex, float *out_dist)
+{
+    return relaxTail(list, count, d, dist, part, rank, out_vertex, out_dist);
+}
+
+// The vector kernels read (vertex, weight) pairs as interleaved 32-bit
+// lanes, which only works while vertex_t is 32-bit
+#if defined(SSSP_X86) && !defined(SSSP_64BIT_IDS)
+
+__attribute__((target("sse2"))) static size_t relaxSSE(const std::pair<vertex_t, float> *list, size_t count, float d,
+                                                       const float *dist, const int *part, int rank,
+                                                       vertex_t *out_vertex, float *out_dist)
+{
+    const float *raw = reinterpret_cast<const float *>(list);
+    __m128 vd = _mm_set1_ps(d);
+    size_t found = 0, i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        // v0 w0 v1 w1 | v2 w2 v3 w3 -> ids and weights; no gather before AVX2
+        __m128 lo = _mm_loadu_ps(raw + 2 * i);
+        __m128 hi = _mm_loadu_ps(raw + 2 * i + 4);
+        __m128i ids = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+        __m128 nd = _mm_add_ps(vd, _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+        alignas(16) int32_t v[4];
+        _mm_store_si128(reinterpret_cast<__m128i *>(v), ids);
+        __m128 cur = _mm_setr_ps(dist[v[0]], dist[v[1]], dist[v[2]], dist[v[3]]);
+        int mask = _mm_movemask_ps(_mm_cmplt_ps(nd, cur));
+        if (!mask)
+            continue;
+        alignas(16) float n[4];
+        _mm_store_ps(n, nd);
+        for (; mask; mask &= mask - 1)
+        {
+            int lane = __builtin_ctz(mask);
+            if (!part || part[v[lane]] == rank)
+            {
+                out_vertex[found] = v[lane];
+                out_dist[found] = n[lane];
+                found++;
+            }
+        }
+    }
+    return found + relaxTail(list + i, count - i, d, dist, part, rank, out_vertex + found, out_dist + found);
+}
+
+// Lane permutations that move the set lanes of an 8-bit mask to the front
+struct CompressTable
+{
+    int32_t perm[256][8];
+    CompressTable()
+    {
+        for (int mask = 0; mask < 256; mask++)
+        {
+            int n = 0;
+            for (int lane = 0; lane < 8; lane++)
+            {
+                if (mask & (1 << lane))
+                    perm[mask][n++] = lane;
+            }
+            while (n < 8)
+                perm[mask][n++] = 0;
+        }
+    }
+};
+static const CompressTable COMPRESS_TABLE;
+
+__attribute__((target("avx2"))) static size_t relaxAVX2(const std::pair<vertex_t, float> *list, size_t count, float d,
+                                                        const float *dist, const int *part, int rank,
+                                                        vertex_t *out_vertex, float *out_dist)
+{
+    const float *raw = reinterpret_cast<const float *>(list);
+    const __m256i split = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    __m256 vd = _mm256_set1_ps(d);
+    __m256i vrank = _mm256_set1_epi32(rank);
+    size_t found = 0, i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        // Two loads of four pairs, each split into ids | weights, then the
+        // halves recombined into eight ids and eight weights
+        __m256 a = _mm256_permutevar8x32_ps(_mm256_loadu_ps(raw + 2 * i), split);
+        __m256 b = _mm256_permutevar8x32_ps(_mm256_loadu_ps(raw + 2 * i + 8), split);
+        __m256i ids = _mm256_castps_si256(_mm256_permute2f128_ps(a, b, 0x20));
+        __m256 nd = _mm256_add_ps(vd, _mm256_permute2f128_ps(a, b, 0x31));
+
+        __m256 cur = _mm256_i32gather_ps(dist, ids, 4);
+        __m256 better = _mm256_cmp_ps(nd, cur, _CMP_LT_OQ);
+        if (part && _mm256_movemask_ps(better))
+        {
+            __m256i owner = _mm256_mask_i32gather_epi32(vrank, part, ids, _mm256_castps_si256(better), 4);
+            better = _mm256_and_ps(better, _mm256_castsi256_ps(_mm256_cmpeq_epi32(owner, vrank)));
+        }
+        int mask = _mm256_movemask_ps(better);
+        if (!mask)
+            continue;
+
+        __m256i perm = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(COMPRESS_TABLE.perm[mask]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out_vertex + found), _mm256_permutevar8x32_epi32(ids, perm));
+        _mm256_storeu_ps(out_dist + found, _mm256_permutevar8x32_ps(nd, perm));
+        found += __builtin_popcount(mask);
+    }
+    return found + relaxTail(list + i, count - i, d, dist, part, rank, out_vertex + found, out_dist + found);
+}
+
+__attribute__((target("avx512f"))) static size_t relaxAVX512(const std::pair<vertex_t, float> *list, size_t count, float d,
+                                                             const float *dist, const int *part, int rank,
+                                                             vertex_t *out_vertex, float *out_dist)
+{
+    const float *raw = reinterpret_cast<const float *>(list);
+    const __m512i even = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+    const __m512i odd = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+    __m512 vd = _mm512_set1_ps(d);
+    __m512i vrank = _mm512_set1_epi32(rank);
+    size_t found = 0, i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m512 lo = _mm512_loadu_ps(raw + 2 * i);
+        __m512 hi = _mm512_loadu_ps(raw + 2 * i + 16);
+        __m512i ids = _mm512_castps_si512(_mm512_permutex2var_ps(lo, even, hi));
+        __m512 nd = _mm512_add_ps(vd, _mm512_permutex2var_ps(lo, odd, hi));
+
+        __m512 cur = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), 0xFFFF, ids, dist, 4);
+        __mmask16 better = _mm512_cmp_ps_mask(nd, cur, _CMP_LT_OQ);
+        if (part && better)
+        {
+            __m512i owner = _mm512_mask_i32gather_epi32(vrank, better, ids, part, 4);
+            better = _mm512_mask_cmpeq_epi32_mask(better, owner, vrank);
+        }
+        if (!better)
+            continue;
+
+        _mm512_mask_compressstoreu_epi32(out_vertex + found, better, ids);
+        _mm512_mask_compressstoreu_ps(out_dist + found, better, nd);
+        found += __builtin_popcount(better);
+    }
+    return found + relaxTail(list + i, count - i, d, dist, part, rank, out_vertex + found, out_dist + found);
+}
+
+#endif
+
+struct KernelChoice
+{
+    const char *name;
+    RelaxKernel kernel;
+};
+
+// Kernels this CPU can run, widest last
+static std::vector<KernelChoice> supportedKernels()
+{
+    std::vector<KernelChoice> kernels = {{"scalar", relaxScalar}};
+#if defined(SSSP_X86) && !defined(SSSP_64BIT_IDS)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+        kernels.push_back({"sse", relaxSSE});
+    if (__builtin_cpu_supports("avx2"))
+        kernels.push_back({"avx2", relaxAVX2});
+    if (__builtin_cpu_supports("avx512f"))
+        kernels.push_back({"avx512", relaxAVX512});
+#endif
+    return kernels;
+}
+
+// A wider kernel has to beat the best narrower one by this much. AVX-512
+// can lower the clock for everything else on the core, so a tie goes to the
+// narrower kernel.
+static const double WIDER_KERNEL_MARGIN = 1.05;
+
+// Relaxations per second of kernel on a synthetic block: random neighbours
+// over a distance array larger than L1, a share of them improving
+static double measureKernel(RelaxKernel kernel)
+{
+    const size_t VERTICES = size_t(1) << 16;
+    std::vector<float> dist(VERTICES);
+    std::vector<std::pair<vertex_t, float>> list(RELAX_BLOCK);
+    unsigned seed = 12345;
+    auto next = [&seed]()
+    { return seed = seed * 1103515245u + 12345u; };
+    for (float &d : dist)
+        d = (next() >> 8) % 1000;
+    for (auto &neighbour : list)
+        neighbour = {static_cast<vertex_t>((next() >> 4) % VERTICES), static_cast<float>((next() >> 8) % 1000)};
+
+    vertex_t out_vertex[RELAX_BLOCK + RELAX_SLACK];
+    float out_dist[RELAX_BLOCK + RELAX_SLACK];
+    long long relaxations = 0;
+    auto start = std::chrono::steady_clock::now();
+    double seconds = 0;
+    while (seconds < 0.002)
+    {
+        for (int i = 0; i < 64; i++)
+            kernel(list.data(), list.size(), 250, dist.data(), nullptr, 0, out_vertex, out_dist);
+        relaxations += 64 * RELAX_BLOCK;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    return relaxations / seconds;
+}
+
+static const KernelChoice &chosenKernel()
+{
+    static const KernelChoice choice = []
+    {
+        std::vector<KernelChoice> kernels = supportedKernels();
+        if (const char *forced = std::getenv("SSSP_SIMD"))
+        {
+            for (const auto &k : kernels)
+            {
+                if (std::strcmp(k.name, forced) == 0)
+                    return k;
+            }
+            std::cerr << "Warning: SSSP_SIMD=" << forced << " is not supported here, picking the fastest" << std::endl;
+        }
+
+        // A short measurement rather than the widest instruction set: gathers
+        // are slow on some cores, and there the narrower kernel wins
+        size_t best = 0;
+        double best_rate = 0;
+        for (size_t i = 0; i < kernels.size(); i++)
+        {
+            measureKernel(kernels[i].kernel); // Warm-up, also brings the unit up to speed
+            double rate = measureKernel(kernels[i].kernel);
+            if (rate > best_rate * WIDER_KERNEL_MARGIN)
+            {
+                best = i;
+                best_rate = rate;
+            }
+        }
+        return kernels[best];
+    }();
+    return choice;
+}
+
+RelaxKernel relaxKernel()
+{
+    return chosenKernel().kernel;
+}
+
+const char *relaxKernelName()
+{
+    return chosenKernel().name;
+}
+
+void benchmarkRelaxKernels(const Graph &graph, const std::vector<float> &dist, int rank)
+{
+    if (graph.compressed)
+    {
+        std::cout << "Relaxation benchmark needs uncompressed adjacency lists" << std::endl;
+        return;
+    }
+
+    // A Bellman-Ford style sweep over the converged distances: every local
+    // vertex is relaxed once more, and nothing is written back
+    const int *part = graph.part.empty() ? nullptr : graph.part.data();
+    std::vector<vertex_t> out_vertex(RELAX_BLOCK + RELAX_SLACK);
+    std::vector<float> out_dist(RELAX_BLOCK + RELAX_SLACK);
+    double scalar_rate = 0;
+    for (const auto &k : supportedKernels())
+    {
+        long long relaxations = 0, improved = 0;
+        auto start = std::chrono::steady_clock::now();
+        double seconds = 0;
+        while (seconds < 0.2)
+        {
+            for (vertex_t u : graph.local_vertices)
+            {
+                float d = dist[u];
+                const auto &list = graph.adj[u];
+                for (size_t b = 0; b < list.size(); b += RELAX_BLOCK)
+                {
+                    size_t n = std::min(RELAX_BLOCK, list.size() - b);
+                    improved += k.kernel(list.data() + b, n, d, dist.data(), part, rank,
+                                         out_vertex.data(), out_dist.data());
+                    relaxations += n;
+                }
+            }
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        double rate = relaxations / seconds;
+        if (scalar_rate == 0)
+            scalar_rate = rate;
+        std::cout << "  " << k.name << ": " << rate / 1e6 << " M relaxations/s per core ("
+                  << rate / scalar_rate << "x scalar, " << 100.0 * improved / relaxations
+                  << "% improving)" << std::endl;
+    }
+}
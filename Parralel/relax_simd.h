@@ -0,0 +1,36 @@
+#ifndef RELAX_SIMD_H
+#define RELAX_SIMD_H
+
+#include "graph.h"
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Neighbours handed to a kernel per call; output buffers need RELAX_BLOCK +
+// RELAX_SLACK entries because the vector kernels store whole registers
+const size_t RELAX_BLOCK = 256;
+const size_t RELAX_SLACK = 16;
+
+// Shorter slices are relaxed inline; below this the indirect call costs more
+// than the vector lanes save
+const size_t RELAX_SIMD_MIN = 16;
+
+// Relaxes d + weight into list[0, count). Neighbours whose distance would
+// drop (and, if part is given, that are owned by rank) are compacted into
+// out_vertex/out_dist with their new distance; returns how many. dist is
+// only read, so the result is a filter the caller still has to apply.
+typedef size_t (*RelaxKernel)(const std::pair<vertex_t, float> *list, size_t count, float d,
+                              const float *dist, const int *part, int rank,
+                              vertex_t *out_vertex, float *out_dist);
+
+// Fastest kernel this CPU supports (scalar, sse, avx2 or avx512), measured
+// for a few milliseconds on first use; a wider kernel has to be clearly
+// faster to be picked. SSSP_SIMD=<name> in the environment forces one.
+RelaxKernel relaxKernel();
+const char *relaxKernelName();
+
+// Times every kernel the CPU supports against the scalar loop over this
+// rank's adjacency lists and prints relaxations per second on one core
+void benchmarkRelaxKernels(const Graph &graph, const std::vector<float> &dist, int rank);
+
+#endif // RELAX_SIMD_H
@@ -0,0 +1,133 @@
+#include "snapshot.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+SnapshotStore::View::View(View &&other) noexcept : slot(other.slot)
+{
+    other.slot = nullptr;
+}
+
+SnapshotStore::View &SnapshotStore::View::operator=(View &&other) noexcept
+{
+    if (this != &other)
+    {
+        if (slot)
+            slot->readers.fetch_sub(1);
+        slot = other.slot;
+        other.slot = nullptr;
+    }
+    return *this;
+}
+
+SnapshotStore::View::~View()
+{
+    if (slot)
+        slot->readers.fetch_sub(1);
+}
+
+float SnapshotStore::View::distance(vertex_t v) const
+{
+    if (v < 0 || v >= size())
+        return std::numeric_limits<float>::infinity();
+    return slot->pages[v / SNAPSHOT_PAGE]->dist[v % SNAPSHOT_PAGE];
+}
+
+vertex_t SnapshotStore::View::parentOf(vertex_t v) const
+{
+    if (v < 0 || v >= size())
+        return -1;
+    return slot->pages[v / SNAPSHOT_PAGE]->parent[v % SNAPSHOT_PAGE];
+}
+
+std::vector<vertex_t> SnapshotStore::View::pathTo(vertex_t v) const
+{
+    // Walks the parents; the tree index only describes the writer's version
+    std::vector<vertex_t> path;
+    if (distance(v) == std::numeric_limits<float>::infinity())
+        return path;
+    for (; v >= 0; v = parentOf(v))
+    {
+        path.push_back(v);
+        if (static_cast<vertex_t>(path.size()) > size())
+            return {};
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+SnapshotStore::View SnapshotStore::acquire() const
+{
+    // Registering before the second look at the epoch means the writer
+    // either sees this reader or has already moved on, and then so do we
+    for (;;)
+    {
+        uint64_t epoch = current.load();
+        const Slot &slot = slots[epoch & 1];
+        slot.readers.fetch_add(1);
+        if (current.load() == epoch)
+            return View(&slot);
+        slot.readers.fetch_sub(1);
+    }
+}
+
+void SnapshotStore::publish(const std::vector<float> &dist, const std::vector<vertex_t> &parent)
+{
+    uint64_t epoch = current.load();
+    const Slot &live = slots[epoch & 1];
+    Slot &next = slots[(epoch + 1) & 1];
+    while (next.readers.load() != 0)
+        std::this_thread::yield();
+
+    vertex_t V = static_cast<vertex_t>(dist.size());
+    size_t num_pages = (V + SNAPSHOT_PAGE - 1) / SNAPSHOT_PAGE;
+    if (next.pages.size() < num_pages)
+        next.pages.resize(num_pages);
+    last_copied = 0;
+    for (size_t p = 0; p < num_pages; p++)
+    {
+        vertex_t first = static_cast<vertex_t>(p) * SNAPSHOT_PAGE;
+        size_t count = std::min(SNAPSHOT_PAGE, V - first);
+
+        // Pages the batch did not touch are shared with the live version
+        auto &page = next.pages[p];
+        if (live.V == V)
+        {
+            const SnapshotPage &old = *live.pages[p];
+            if (std::memcmp(old.dist, &dist[first], count * sizeof(float)) == 0 &&
+                std::memcmp(old.parent, &parent[first], count * sizeof(vertex_t)) == 0)
+            {
+                if (page.use_count() == 1)
+                    spare.push_back(std::move(page));
+                page = live.pages[p];
+                continue;
+            }
+        }
+
+        // A page only this slot holds is rewritten in place; no reader can
+        // see it. Otherwise take a spare one so steady batches do not allocate.
+        if (!page || page.use_count() > 1)
+        {
+            if (spare.empty())
+                page = std::make_shared<SnapshotPage>();
+            else
+            {
+                page = std::move(spare.back());
+                spare.pop_back();
+            }
+        }
+        std::copy_n(&dist[first], count, page->dist);
+        std::copy_n(&parent[first], count, page->parent);
+        last_copied++;
+    }
+    for (size_t p = num_pages; p < next.pages.size(); p++)
+    {
+        if (next.pages[p].use_count() == 1)
+            spare.push_back(std::move(next.pages[p]));
+    }
+    next.pages.resize(num_pages);
+    next.V = V;
+    next.epoch = epoch + 1;
+    current.store(epoch + 1);
+}
@@ -0,0 +1,81 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "sssp_types.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Vertices per copy-on-write page of a snapshot
+const vertex_t SNAPSHOT_PAGE = 4096;
+
+struct SnapshotPage
+{
+    float dist[SNAPSHOT_PAGE];
+    vertex_t parent[SNAPSHOT_PAGE];
+};
+
+// Versions of the published distances and parents that other threads can
+// query while the next batch is applied. Two slots take turns: publish()
+// rewrites the one readers have moved off and then bumps the epoch, which
+// makes it current. The slots share every page a batch left unchanged, so a
+// version costs only the pages its changed vertices fall in.
+//
+// Readers never wait: acquire() registers with the current slot and checks
+// the epoch did not move in the meantime, retrying if it did. The writer
+// waits for the last reader of a slot before rewriting it, which happens
+// two publishes after that reader arrived. One thread publishes.
+class SnapshotStore
+{
+    struct alignas(64) Slot
+    {
+        std::vector<std::shared_ptr<SnapshotPage>> pages;
+        vertex_t V = 0;
+        uint64_t epoch = 0;
+        mutable std::atomic<int> readers{0};
+    };
+
+public:
+    // A consistent version, held until the view is destroyed. Keep views
+    // short-lived: the writer cannot publish twice while one is open.
+    class View
+    {
+    public:
+        View() = default;
+        View(View &&other) noexcept;
+        View &operator=(View &&other) noexcept;
+        View(const View &) = delete;
+        View &operator=(const View &) = delete;
+        ~View();
+
+        uint64_t epoch() const { return slot ? slot->epoch : 0; }
+        vertex_t size() const { return slot ? slot->V : 0; }
+        float distance(vertex_t v) const;
+        vertex_t parentOf(vertex_t v) const;
+        // Source first, v last; empty if v is unreachable
+        std::vector<vertex_t> pathTo(vertex_t v) const;
+
+    private:
+        friend class SnapshotStore;
+        explicit View(const Slot *slot) : slot(slot) {}
+        const Slot *slot = nullptr;
+    };
+
+    long long last_copied = 0; // Pages the last publish() could not share
+
+    SnapshotStore() = default;
+    SnapshotStore(const SnapshotStore &) = delete;
+    SnapshotStore &operator=(const SnapshotStore &) = delete;
+
+    View acquire() const;
+    void publish(const std::vector<float> &dist, const std::vector<vertex_t> &parent);
+    uint64_t epoch() const { return current.load(); }
+
+private:
+    Slot slots[2];
+    std::atomic<uint64_t> current{0}; // Slot current & 1 is the readers'
+    std::vector<std::shared_ptr<SnapshotPage>> spare; // Pages no slot uses, for reuse
+};
+
+#endif // SNAPSHOT_H
@@ -1,76 +1,447 @@
 #include "sssp.h"
+#include "relax_simd.h"
 #include <algorithm>
 #include <limits>
+#include <numeric>
 #include <queue>
+#include <type_traits>
 #include <mpi.h>
 #include <omp.h>
 #include <iostream>
 
-SSSP::SSSP(int V) : dist(V, std::numeric_limits<float>::infinity()),
-                    parent(V, -1),
-                    affected(V, false),
-                    affected_del(V, false) {}
+// dist accessors for code running under the task scheduler, where several
+// threads may relax into the same vertex at once
+static inline float loadDist(float &d)
+{
+    float value;
+#pragma omp atomic read
+    value = d;
+    return value;
+}
+
+// Only for a vertex no other thread writes at the same time
+static inline void storeDist(float &d, float value)
+{
+#pragma omp atomic write
+    d = value;
+}
+
+// Lowers target to value; true if value was smaller
+static inline bool lowerDist(float &target, float value)
+{
+    float old;
+#pragma omp atomic compare capture
+    {
+        old = target;
+        if (value < target)
+        {
+            target = value;
+        }
+    }
+    return value < old;
+}
+
+// Sets flag; true if this call was the one that set it
+static inline bool claimFlag(char &flag)
+{
+    char was;
+#pragma omp atomic capture
+    {
+        was = flag;
+        flag = 1;
+    }
+    return !was;
+}
+
+// Calls improve(v, new_dist) for every local neighbour in [begin, end) of
+// u's list that d + weight would lower. Uncompressed slices of at least
+// RELAX_SIMD_MIN neighbours are filtered with the SIMD kernel. dist is only
+// read; improve has to apply the change.
+template <typename F>
+static void relaxNeighbors(const Graph &graph, vertex_t u, edge_t begin, edge_t end, float d,
+                           const float *dist, int rank, F &&improve)
+{
+    const int *part = graph.part.empty() ? nullptr : graph.part.data();
+    if (graph.compressed || static_cast<size_t>(end - begin) < RELAX_SIMD_MIN)
+    {
+        graph.forEachNeighborInRange(u, begin, end, [&](vertex_t v, float weight)
+                                     {
+                                         float new_dist = d + weight;
+                                         if (new_dist < dist[v] && (!part || part[v] == rank))
+                                             improve(v, new_dist); });
+        return;
+    }
+
+    RelaxKernel kernel = relaxKernel();
+    const auto *list = graph.adj[u].data();
+    vertex_t out_vertex[RELAX_BLOCK + RELAX_SLACK];
+    float out_dist[RELAX_BLOCK + RELAX_SLACK];
+    for (edge_t b = begin; b < end; b += RELAX_BLOCK)
+    {
+        size_t n = std::min<edge_t>(RELAX_BLOCK, end - b);
+        size_t found = kernel(list + b, n, d, dist, part, rank, out_vertex, out_dist);
+        for (size_t i = 0; i < found; i++)
+            improve(out_vertex[i], out_dist[i]);
+    }
+}
+
+// repaired lists a vertex each time a round improves it. Folding the
+// duplicates away whenever it fills keeps it within the V it was reserved
+// for; a list still full after that already holds every vertex.
+static void addRepaired(std::vector<vertex_t> &repaired, vertex_t v)
+{
+    if (repaired.size() == repaired.capacity())
+    {
+        std::sort(repaired.begin(), repaired.end());
+        repaired.erase(std::unique(repaired.begin(), repaired.end()), repaired.end());
+        if (repaired.size() == repaired.capacity())
+            return;
+    }
+    repaired.push_back(v);
+}
+
+// Push/pull choice for the next relaxation round, with the hysteresis of
+// direction-optimizing BFS: switch to pull once the frontier's edges exceed
+// 1/PULL_ALPHA of the partition's, and back to push once it has shrunk
+// below 1/PUSH_BETA of the local vertices. A pull round scans every local
+// edge but needs no atomic updates, so it only pays off for big frontiers,
+// e.g. the initial SSSP or a deletion close to the source.
+static const double PULL_ALPHA = 2;
+static const double PUSH_BETA = 16;
+
+static bool choosePull(RelaxDirection direction, bool pulling, size_t frontier_vertices,
+                       edge_t frontier_edges, size_t local_vertices, edge_t local_edges)
+{
+    if (direction != RELAX_AUTO)
+        return direction == RELAX_PULL;
+    if (pulling)
+        return frontier_vertices * PUSH_BETA >= local_vertices;
+    return frontier_edges * PULL_ALPHA > local_edges;
+}
+
+SSSP::SSSP(vertex_t V)
+{
+    resize(V);
+}
+
+// Device buffers and kernels go before the queues they were made on
+SSSP::~SSSP()
+{
+    for (DeviceGraph &dev : devices)
+        releaseDeviceGraph(dev);
+    cleanupOpenCL(opencl_ctx);
+}
+
+void SSSP::resize(vertex_t V, bool use_openmp)
+{
+    // Same static split as placedFill uses for every array, so a thread's
+    // block of dist, parent and flags shares one NUMA node
+    placedFill(dist, V, std::numeric_limits<float>::infinity(), use_openmp);
+    placedFill(parent, V, vertex_t(-1), use_openmp);
+    placedFill(affected, V, char(0), use_openmp);
+    placedFill(affected_del, V, char(0), use_openmp);
+    ws.reserve(V);
+}
 
-void SSSP::initialize(int source)
+void SSSP::initialize(vertex_t source, bool use_openmp)
 {
-    if (source < 0 || source >= static_cast<int>(dist.size()))
+    if (source < 0 || source >= static_cast<vertex_t>(dist.size()))
     {
         std::cerr << "Error: Invalid source vertex " << source << std::endl;
         return;
     }
 
-    std::fill(dist.begin(), dist.end(), std::numeric_limits<float>::infinity());
-    std::fill(parent.begin(), parent.end(), -1);
-    std::fill(affected.begin(), affected.end(), false);
-    std::fill(affected_del.begin(), affected_del.end(), false);
+    resize(dist.size(), use_openmp);
     dist[source] = 0;
 
     // Mark source as affected to trigger initial computation
     affected[source] = true;
 }
 
-void SSSP::prepareGraphForOpenCL(const Graph &graph)
+bool SSSP::prepareGraphForOpenCL(const Graph &graph)
 {
-    // Convert adjacency list to edge pairs and weights for OpenCL
-    edge_pairs.clear();
-    edge_weights.clear();
+    // The kernels take 32-bit vertex IDs and edge offsets
+    edge_t directed_edges = 0;
+    for (vertex_t u = 0; u < graph.V; u++)
+        directed_edges += graph.degree(u);
+    if (graph.V > std::numeric_limits<cl_int>::max() ||
+        directed_edges > std::numeric_limits<cl_uint>::max())
+    {
+        std::cerr << "Warning: Graph too large for the OpenCL kernels, using the CPU" << std::endl;
+        return false;
+    }
+
+    // Convert adjacency lists to CSR; ghost vertices keep their lists so
+    // they can push into local neighbours
+    csr_offsets.assign(graph.V + 1, 0);
+    csr_targets.clear();
+    csr_weights.clear();
+    csr_targets.reserve(directed_edges);
+    csr_weights.reserve(directed_edges);
+    for (vertex_t u = 0; u < graph.V; u++)
+    {
+        graph.forEachNeighbor(u, [&](vertex_t v, float weight)
+                              {
+                                  csr_targets.push_back(static_cast<cl_int>(v));
+                                  csr_weights.push_back(weight); });
+        csr_offsets[u + 1] = csr_targets.size();
+    }
 
-    for (int u = 0; u < graph.V; u++)
+    // Initialize OpenCL if not already done. Updates never add negative
+    // weights, so the first graph decides whether integer atomics are safe.
+    if (!opencl_available)
     {
-        for (const auto &neighbor : graph.adj[u])
+        KernelConfig config;
+        config.int_atomics = std::none_of(csr_weights.begin(), csr_weights.end(), [](float w)
+                                          { return w < 0; });
+        opencl_available = setupOpenCL(opencl_ctx, config);
+        if (!opencl_available)
         {
-            int v = neighbor.first;
-            float weight = neighbor.second;
+            std::cerr << "Warning: OpenCL initialization failed, falling back to CPU implementation" << std::endl;
+            return false;
+        }
+    }
+    splitAcrossDevices(graph);
+    return true;
+}
+
+// Deals the local vertices out to the devices in contiguous runs of about
+// equal work per unit of speed. Until every device has been measured the
+// compute unit counts stand in for speed.
+void SSSP::splitAcrossDevices(const Graph &graph)
+{
+    size_t n = opencl_ctx.devices.size();
+    devices.resize(n);
+    device_speed.resize(n, 0);
+    std::vector<double> weight(n);
+    bool measured = std::all_of(device_speed.begin(), device_speed.end(), [](double s)
+                                { return s > 0; });
+    for (size_t d = 0; d < n; d++)
+    {
+        cl_uint units = 1;
+        clGetDeviceInfo(opencl_ctx.devices[d], CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(units), &units, NULL);
+        weight[d] = measured ? device_speed[d] : std::max<cl_uint>(units, 1);
+    }
+    double total_weight = std::accumulate(weight.begin(), weight.end(), 0.0);
 
-            // Avoid duplicate edges (since this is an undirected graph)
-            if (u < v)
+    // A vertex costs its edges plus one for the visit itself
+    double total_work = 0;
+    for (vertex_t v : graph.local_vertices)
+        total_work += csr_offsets[v + 1] - csr_offsets[v] + 1;
+
+    device_owner.assign(graph.V, -1);
+    device_local.resize(n);
+    for (auto &list : device_local)
+        list.clear();
+    size_t d = 0;
+    double done = 0, share = weight[0];
+    for (vertex_t v : graph.local_vertices)
+    {
+        while (d + 1 < n && done >= total_work * share / total_weight)
+            share += weight[++d];
+        device_owner[v] = d;
+        device_local[d].push_back(v);
+        done += csr_offsets[v + 1] - csr_offsets[v] + 1;
+    }
+
+    device_boundary.assign(graph.V, 0);
+    if (n > 1)
+    {
+        for (vertex_t v : graph.local_vertices)
+        {
+            for (cl_uint e = csr_offsets[v]; e < csr_offsets[v + 1]; e++)
             {
-                edge_pairs.push_back({u, v});
-                edge_weights.push_back(weight);
+                cl_int owner = device_owner[csr_targets[e]];
+                if (owner >= 0 && owner != device_owner[v])
+                    device_boundary[v] = 1;
             }
         }
     }
+}
 
-    // Initialize OpenCL if not already done
-    if (!opencl_available)
+// Parents as the kernels take them: the array itself with 32-bit IDs, which
+// a zero-copy device then writes in place, else a narrowed copy
+template <typename T>
+static placed_vector<cl_int> &deviceParents(placed_vector<T> &parent, placed_vector<cl_int> &narrowed)
+{
+    if constexpr (std::is_same<T, cl_int>::value)
+        return parent;
+    else
     {
-        opencl_available = setupOpenCL(opencl_ctx, "relax_edges.cl");
-        if (!opencl_available)
+        narrowed.assign(parent.begin(), parent.end());
+        return narrowed;
+    }
+}
+
+// Copies the CSR, distances and parents to every device
+bool SSSP::uploadToDevices()
+{
+    auto &device_parent = deviceParents(parent, ws.device_parent);
+    for (size_t d = 0; d < devices.size(); d++)
+    {
+        if (!uploadGraph(opencl_ctx, devices[d], d, csr_offsets, csr_targets, csr_weights,
+                         device_local[d], device_owner, device_parent, dist))
+            return false;
+    }
+    return true;
+}
+
+void SSSP::updateStep1(const Graph &graph, const std::vector<Edge> &inserts,
+                       const std::vector<Edge> &deletes, const std::vector<Edge> &increases,
+                       bool use_openmp, bool use_opencl)
+{
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    // Each rank only owns the distances of its local vertices, so make sure
+    // ghost values (including ghosts created by this batch) are current
+    halo.setup(graph, comm, 1);
+    halo.exchangeAll(dist);
+
+    // Weight decreases are already among the inserts; increases the tree
+    // cannot absorb invalidate their subtree like a deletion would
+    const std::vector<Edge> &invalidating = resolveTreeEdges(graph, deletes, increases, rank, !use_opencl);
+
+    device_resident = false;
+    if (use_opencl && prepareGraphForOpenCL(graph))
+    {
+        device_resident = applyUpdatesOnDevices(graph, inserts, invalidating);
+        if (device_resident)
+            return;
+        std::cerr << "Warning: OpenCL Step 1 failed, using the CPU" << std::endl;
+    }
+    applyUpdatesOnHost(graph, inserts, invalidating, rank, use_openmp);
+}
+
+// A heavier tree edge only strands its child if no other neighbour gives the
+// same distance. One that is strictly closer cannot be in the child's
+// subtree, so it can take over as parent and nothing below has to move.
+// Otherwise the child's subtree is invalidated as for a deletion; the edge
+// itself stays, with its new weight, for Step 2 to relax.
+//
+// With epsilon the same goes for deleted tree edges. With detours, a child
+// whose best other neighbour is within (1 + epsilon) of its old distance
+// moves over to it: it is raised to that detour, which is a real path, and
+// flagged for Phase 1 so only its children are invalidated below it. Their
+// distances came from the old, shorter one. Device Step 1 only invalidates
+// from cut-off vertices, so there every such child is cut off.
+const std::vector<Edge> &SSSP::resolveTreeEdges(const Graph &graph, const std::vector<Edge> &deletes,
+                                                const std::vector<Edge> &increases, int rank, bool detours)
+{
+    reparented = 0;
+    spared = 0;
+    skipped = 0;
+    bool approximate = epsilon > 0;
+    if (increases.empty() && !approximate)
+        return deletes;
+
+    auto is_local = [&](vertex_t v)
+    { return graph.part.empty() || graph.part[v] == rank; };
+    const float slack = 1 + epsilon;
+    auto &invalidating = ws.invalidating;
+    invalidating.clear();
+    auto resolve = [&](const Edge &e)
+    {
+        if (e.u < 0 || e.u >= graph.V || e.v < 0 || e.v >= graph.V)
+            return;
+        for (auto [child, up] : {std::pair<vertex_t, vertex_t>{e.v, e.u}, {e.u, e.v}})
         {
-            std::cerr << "Warning: OpenCL initialization failed, falling back to CPU implementation" << std::endl;
+            if (!is_local(child) || parent[child] != up)
+                continue;
+            vertex_t other = -1;
+            float d = dist[child], best = std::numeric_limits<float>::infinity();
+            graph.forEachNeighbor(child, [&](vertex_t n, float weight)
+                                  {
+                                      if (n != up && dist[n] < d && dist[n] + weight < best)
+                                      {
+                                          best = dist[n] + weight;
+                                          other = n;
+                                      } });
+            if (other >= 0 && best <= d)
+                reparented++;
+            else if (other >= 0 && detours && best <= d * slack)
+            {
+                dist[child] = best;
+                affected[child] = true;
+                affected_del[child] = true;
+                spared++;
+            }
+            else
+            {
+                invalidating.push_back(e);
+                continue;
+            }
+            parent[child] = other;
         }
+    };
+    for (const Edge &e : deletes)
+    {
+        if (approximate)
+            resolve(e);
+        else
+            invalidating.push_back(e);
     }
+    for (const Edge &e : increases)
+        resolve(e);
+    return invalidating;
 }
 
-void SSSP::updateStep1(const Graph &graph, const std::vector<Edge> &inserts,
-                       const std::vector<Edge> &deletes, bool use_openmp)
+// Uploads the graph and the batch and applies the deletions; insertions wait
+// for the end of Phase 1. Only the batch goes in; the host arrays stay as
+// they are until the changed vertices are compacted back.
+bool SSSP::applyUpdatesOnDevices(const Graph &graph, const std::vector<Edge> &inserts,
+                                 const std::vector<Edge> &deletes)
 {
+    ws.batch_inserts.assign(inserts.begin(), inserts.end());
+    ws.batch_deletes.assign(deletes.begin(), deletes.end());
+
+    // Deletions first, which is the layout applyBatch takes
+    auto &ends = ws.device_ends;
+    auto &weights = ws.device_weights;
+    auto &num_deletes = ws.device_deletes;
+    ends.clear();
+    weights.clear();
+    num_deletes = 0;
+    for (const auto *list : {&deletes, &inserts})
+    {
+        for (const Edge &e : *list)
+        {
+            if (e.u < 0 || e.u >= graph.V || e.v < 0 || e.v >= graph.V)
+            {
+                std::cerr << "Warning: Invalid edge in " << (list == &deletes ? "deletions: " : "insertions: ")
+                          << e.u << " " << e.v << std::endl;
+                continue;
+            }
+            ends.push_back(static_cast<cl_int>(e.u));
+            ends.push_back(static_cast<cl_int>(e.v));
+            weights.push_back(e.weight);
+        }
+        if (list == &deletes)
+            num_deletes = weights.size();
+    }
+
+    if (!uploadToDevices())
+        return false;
+    for (size_t d = 0; d < devices.size(); d++)
+    {
+        if (!applyBatch(opencl_ctx, devices[d], ends, weights, num_deletes))
+            return false;
+    }
+    return true;
+}
+
+void SSSP::applyUpdatesOnHost(const Graph &graph, const std::vector<Edge> &inserts,
+                              const std::vector<Edge> &deletes, int rank, bool use_openmp)
+{
+    auto is_local = [&](vertex_t v)
+    { return graph.part.empty() || graph.part[v] == rank; };
+
 #pragma omp parallel for if (use_openmp)
     for (size_t i = 0; i < deletes.size(); i++)
     {
         const Edge &e = deletes[i];
-        if (e.u < 0 || e.u >= static_cast<int>(dist.size()) ||
-            e.v < 0 || e.v >= static_cast<int>(dist.size()))
+        if (e.u < 0 || e.u >= static_cast<vertex_t>(dist.size()) ||
+            e.v < 0 || e.v >= static_cast<vertex_t>(dist.size()))
         {
 #pragma omp critical
             {
@@ -78,21 +449,21 @@ void SSSP::updateStep1(const Graph &graph, const std::vector<Edge> &inserts,
             }
             continue;
         }
-        // Always mark both vertices as affected for deletion
-        affected_del[e.u] = true;
-        affected_del[e.v] = true;
-        affected[e.u] = true;
-        affected[e.v] = true;
-        // Reset distances if the edge was part of the shortest path
-        if (parent[e.v] == e.u)
+        // Reset the child endpoint if the edge was part of the shortest path;
+        // only its subtree needs to be invalidated in Step 2
+        if (is_local(e.v) && parent[e.v] == e.u)
         {
             dist[e.v] = std::numeric_limits<float>::infinity();
             parent[e.v] = -1;
+            affected_del[e.v] = true;
+            affected[e.v] = true;
         }
-        if (parent[e.u] == e.v)
+        if (is_local(e.u) && parent[e.u] == e.v)
         {
             dist[e.u] = std::numeric_limits<float>::infinity();
             parent[e.u] = -1;
+            affected_del[e.u] = true;
+            affected[e.u] = true;
         }
     }
 
@@ -100,12 +471,12 @@ void SSSP::updateStep1(const Graph &graph, const std::vector<Edge> &inserts,
     for (size_t i = 0; i < inserts.size(); i++)
     {
         const Edge &e = inserts[i];
-        int u = e.u, v = e.v;
+        vertex_t u = e.u, v = e.v;
         float weight = e.weight;
 
         // Validate edge vertices
-        if (u < 0 || u >= static_cast<int>(dist.size()) ||
-            v < 0 || v >= static_cast<int>(dist.size()))
+        if (u < 0 || u >= static_cast<vertex_t>(dist.size()) ||
+            v < 0 || v >= static_cast<vertex_t>(dist.size()))
         {
 #pragma omp critical
             {
@@ -117,7 +488,13 @@ void SSSP::updateStep1(const Graph &graph, const std::vector<Edge> &inserts,
         if (dist[u] > dist[v])
             std::swap(u, v);
 
-        if (dist[v] > dist[u] + weight)
+        // Only the owner of the farther endpoint may lower its distance
+        if (is_local(v) && dist[v] > dist[u] + weight && !acceptable(dist[u], dist[u] + weight, dist[v]))
+        {
+#pragma omp atomic
+            skipped++;
+        }
+        else if (is_local(v) && dist[v] > dist[u] + weight)
         {
             dist[v] = dist[u] + weight;
             parent[v] = u;
@@ -128,195 +505,806 @@ void SSSP::updateStep1(const Graph &graph, const std::vector<Edge> &inserts,
 
 void SSSP::updateStep2(Graph &graph, bool use_openmp, int async_level, bool use_opencl)
 {
-    if (use_opencl && opencl_available)
-    {
+    // After a device Step 1 the graph is already prepared and uploaded
+    bool use_device = use_opencl && (device_resident || prepareGraphForOpenCL(graph));
+    if (use_device)
         std::cout << "Running OpenCL SSSP on GPU..." << std::endl;
-        prepareGraphForOpenCL(graph);
-        runRelaxationKernel(opencl_ctx, dist, parent, edge_pairs, edge_weights);
-    }
     else
-    {
         std::cout << "Running CPU SSSP..." << std::endl;
-        updateStep2CPU(graph, use_openmp, async_level);
-    }
+    updateStep2CPU(graph, use_openmp, async_level, use_device);
 }
 
-void SSSP::updateStep2CPU(Graph &graph, bool use_openmp, int async_level)
+void SSSP::updateStep2CPU(Graph &graph, bool use_openmp, int async_level, bool use_device)
 {
-    bool changed;
-    int iterations = 0;
-    const int MAX_ITERATIONS = 100;
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    const float INF = std::numeric_limits<float>::infinity();
+    const int POLL_INTERVAL = 256;
+
+    // Owner-computes: ranks only write distances of their local vertices.
+    // Ghost distances arrive asynchronously from their owners and are
+    // consumed as they land, while local relaxation continues.
+    auto is_local = [&](vertex_t v)
+    { return graph.part.empty() || graph.part[v] == rank; };
 
-    // Preserve initial distances and reset only affected vertices
-    std::vector<float> temp_dist = dist;
-    std::vector<int> temp_parent = parent;
+    halo.setup(graph, comm, async_level);
+    halo.begin(0);
+    termination.reset();
+    auto &arrived = ws.arrived;
 
-    do
+    // Phase 1: Invalidate subtrees hanging off deleted tree edges. Children
+    // on other ranks learn about it from the boundary message for the parent.
+    // After a device Step 1 the deleted vertices are still flagged on the
+    // devices, and the frontier only holds ghosts other ranks invalidated.
+    auto &frontier = ws.frontier;
+    auto &next = ws.next;
+    frontier.clear();
+    for (vertex_t v : graph.local_vertices)
     {
-        changed = false;
-        iterations++;
+        if (affected_del[v])
+        {
+            frontier.push_back(v);
+            halo.markChanged(v);
+        }
+    }
+    bool device_pending = device_resident;
+    ws.cross_device.clear();
 
-        // Phase 1: Handle deletions and reset affected subtrees
-#pragma omp parallel for if (use_openmp) schedule(dynamic)
-        for (int v = 0; v < graph.V; v++)
+    // Ranks loop until termination is detected; an idle rank keeps consuming
+    // boundary updates while the detection wave is in flight
+    int iterations = 0;
+    bool converged = false;
+    while (!converged)
+    {
+        if (device_resident && (device_pending || !frontier.empty()))
         {
-            if (affected_del[v])
+            iterations++;
+            if (!invalidateOnDevices(frontier, device_pending))
             {
-                affected_del[v] = false;
-                bool local_changed = false;
-                for (const auto &neighbor : graph.adj[v])
+                // Redo Step 1 on the host over what was mirrored so far, then
+                // invalidate below every vertex known to be invalid. Children
+                // already handled are simply found again.
+                std::cerr << "Warning: OpenCL invalidation failed, finishing on the CPU" << std::endl;
+                device_resident = device_pending = false;
+                // A zero-copy device may have cut vertices the host has not
+                // heard about yet, and the insertions must not hide them
+                for (vertex_t v : graph.local_vertices)
+                {
+                    if (dist[v] == INF)
+                        affected_del[v] = true;
+                }
+                applyUpdatesOnHost(graph, ws.batch_inserts, ws.batch_deletes, rank, use_openmp);
+                frontier.clear();
+                for (const auto *list : {&graph.local_vertices, &graph.ghost_vertices})
                 {
-                    int c = neighbor.first;
-                    if (c >= 0 && c < static_cast<int>(parent.size()) && parent[c] == v)
+                    for (vertex_t v : *list)
                     {
-#pragma omp critical
+                        if (dist[v] != INF && !affected_del[v])
+                            continue;
+                        if (is_local(v))
                         {
-                            dist[c] = std::numeric_limits<float>::infinity();
-                            parent[c] = -1;
-                            affected_del[c] = true;
-                            affected[c] = true;
-                            local_changed = true;
+                            affected[v] = true;
+                            halo.markChanged(v);
                         }
+                        frontier.push_back(v);
                     }
                 }
-                if (local_changed)
+            }
+        }
+
+        if (!device_resident && !frontier.empty())
+            iterations++;
+
+        if (!device_resident && use_openmp && !frontier.empty())
+            invalidateSubtrees(graph, frontier, rank);
+
+        while (!device_resident && !frontier.empty())
+        {
+            auto &children = ws.threadLists(use_openmp ? omp_get_max_threads() : 1);
+#pragma omp parallel if (use_openmp)
+            {
+                auto &local_next = children[omp_get_thread_num()];
+#pragma omp for schedule(dynamic)
+                for (size_t i = 0; i < frontier.size(); i++)
                 {
-#pragma omp atomic write
-                    changed = true;
+                    vertex_t v = frontier[i];
+                    graph.forEachNeighbor(v, [&](vertex_t c, float)
+                                          {
+                                              // A vertex has a single parent, so no two threads touch c
+                                              if (is_local(c) && parent[c] == v)
+                                              {
+                                                  dist[c] = INF;
+                                                  parent[c] = -1;
+                                                  local_next.push_back(c);
+                                              } });
                 }
             }
-        }
 
-        // Phase 2: Recompute paths for all vertices
-        std::vector<bool> visited(graph.V, false);
-        std::priority_queue<std::pair<float, int>, std::vector<std::pair<float, int>>, std::greater<>> pq;
+            next.clear();
+            for (const auto &list : children)
+                next.insert(next.end(), list.begin(), list.end());
+
+            for (vertex_t v : frontier)
+                affected_del[v] = false;
+            for (vertex_t c : next)
+            {
+                affected[c] = true;
+                affected_del[c] = true;
+                halo.markChanged(c);
+            }
+            frontier.swap(next);
+        }
 
-        // Initialize with vertices that have finite distances
-        for (int v = 0; v < graph.V; v++)
+        halo.flush(dist);
+        arrived.clear();
+        halo.poll(arrived);
+        // Every message in this phase announces an invalidated vertex
+        for (const auto &update : arrived)
         {
-            if (dist[v] != std::numeric_limits<float>::infinity())
+            dist[update.vertex] = update.dist;
+            if (device_resident)
             {
-                pq.push({dist[v], v});
+                frontier.push_back(update.vertex);
+                continue;
             }
+            graph.forEachNeighbor(update.vertex, [&](vertex_t c, float)
+                                  {
+                                      if (is_local(c) && parent[c] == update.vertex)
+                                      {
+                                          dist[c] = INF;
+                                          parent[c] = -1;
+                                          affected[c] = true;
+                                          affected_del[c] = true;
+                                          halo.markChanged(c);
+                                          frontier.push_back(c);
+                                      } });
         }
 
+        converged = hasConverged(comm, !frontier.empty() || device_pending);
+    }
+
+    // Every rank is done invalidating, so the insertions can go in; what they
+    // improve comes back with the first compaction of Phase 2
+    for (size_t d = 0; device_resident && d < devices.size(); d++)
+    {
+        if (!applyInsertions(opencl_ctx, devices[d], ws.device_deletes, ws.device_weights.size() - ws.device_deletes))
+        {
+            std::cerr << "Warning: OpenCL insertions failed, finishing on the CPU" << std::endl;
+            device_resident = false;
+            applyUpdatesOnHost(graph, ws.batch_inserts, {}, rank, use_openmp);
+        }
+    }
+
+    // Phase 2: Repair affected vertices with a label-correcting sweep over
+    // the local partition. Affected vertices first pull the best value from
+    // their neighbours, then improvements are pushed outwards.
+    if (use_openmp || use_device)
+    {
+        relaxRounds(graph, rank, iterations, use_openmp, use_device);
+        std::cout << "SSSP converged after " << iterations << " iterations ("
+                  << termination.waves << " termination waves)." << std::endl;
+        return;
+    }
+
+    // Min-heap on distance, kept in the workspace so its capacity survives
+    auto &pq = ws.heap;
+    pq.clear();
+    auto push = [&](float d, vertex_t v)
+    {
+        pq.emplace_back(d, v);
+        std::push_heap(pq.begin(), pq.end(), std::greater<>());
+    };
+    for (vertex_t v : graph.local_vertices)
+    {
+        if (!affected[v])
+            continue;
+        affected[v] = false;
+        affected_del[v] = false;
+
+        graph.forEachNeighbor(v, [&](vertex_t u, float weight)
+                              {
+                                  float new_dist = dist[u] + weight;
+                                  if (new_dist < dist[v])
+                                  {
+                                      dist[v] = new_dist;
+                                      parent[v] = u;
+                                  } });
+        if (dist[v] != INF)
+        {
+            push(dist[v], v);
+            halo.markChanged(v);
+        }
+    }
+
+    int pops = 0;
+    converged = false;
+    halo.end();
+    halo.begin(1);
+    termination.reset();
+    while (!converged)
+    {
+        bool local_active = !pq.empty();
+        if (local_active)
+            iterations++;
+
         while (!pq.empty())
         {
-            auto [d, u] = pq.top();
-            pq.pop();
-            if (visited[u])
+            std::pop_heap(pq.begin(), pq.end(), std::greater<>());
+            auto [d, u] = pq.back();
+            pq.pop_back();
+            if (d > dist[u])
                 continue;
-            visited[u] = true;
 
-            for (const auto &neighbor : graph.adj[u])
+            // Ghost vertices only relax into local vertices; their owner
+            // handles everything else. Parallel edges can repeat v within
+            // one call, so the kernel's hits are re-checked.
+            relaxNeighbors(graph, u, 0, graph.degree(u), d, dist.data(), rank, [&](vertex_t v, float new_dist)
+                           {
+                               if (!acceptable(d, new_dist, dist[v]))
+                               {
+                                   if (new_dist < dist[v])
+                                       skipped++;
+                               }
+                               else
+                               {
+                                   dist[v] = new_dist;
+                                   parent[v] = u;
+                                   push(new_dist, v);
+                                   halo.markChanged(v);
+                               } });
+
+            // Overlap: ship boundary changes and fold in incoming ghost
+            // distances while the rest of the partition is still relaxing
+            if (++pops % POLL_INTERVAL == 0)
             {
-                int v = neighbor.first;
-                float weight = neighbor.second;
-                if (v >= 0 && v < static_cast<int>(dist.size()))
+                halo.flush(dist);
+                arrived.clear();
+                halo.poll(arrived);
+                for (const auto &update : arrived)
                 {
-                    float new_dist = dist[u] + weight;
-                    if (new_dist < dist[v])
-                    {
-                        dist[v] = new_dist;
-                        parent[v] = u;
-                        pq.push({new_dist, v});
-                        affected[v] = true;
-                        changed = true;
-                    }
+                    dist[update.vertex] = update.dist;
+                    push(update.dist, update.vertex);
                 }
             }
         }
 
-        if (iterations % 10 == 0)
+        halo.flush(dist);
+        arrived.clear();
+        halo.poll(arrived);
+        for (const auto &update : arrived)
         {
-            std::cout << "Iteration " << iterations << ", changed = " << changed << std::endl;
+            dist[update.vertex] = update.dist;
+            push(update.dist, update.vertex);
         }
 
-        if (async_level > 1 && iterations % async_level == 0)
-        {
-            std::vector<float> global_dist(graph.V);
-            for (int i = 0; i < graph.V; i++)
-            {
-                global_dist[i] = dist[i];
-            }
-            graph.gatherSSSPResults(MPI_COMM_WORLD, global_dist);
+        converged = hasConverged(comm, !pq.empty());
 
-            for (int i = 0; i < graph.V; i++)
-            {
-                if (global_dist[i] < dist[i])
-                {
-                    dist[i] = global_dist[i];
-                    affected[i] = true;
-                    changed = true;
-                }
-            }
+        if (local_active && iterations % 10 == 0)
+        {
+            std::cout << "Iteration " << iterations << ", converged = " << converged << std::endl;
         }
+    }
+
+    halo.end();
+
+    std::cout << "SSSP converged after " << iterations << " iterations ("
+              << termination.waves << " termination waves)." << std::endl;
+}
 
-    } while (changed && iterations < MAX_ITERATIONS);
+bool SSSP::hasConverged(MPI_Comm comm, bool local_active)
+{
+    // Non-blocking: joins a detection wave only while this rank has neither
+    // local work nor queued boundary changes, and returns false until a wave
+    // confirms global termination
+    bool idle = !local_active && !halo.hasPending();
+    return termination.poll(comm, idle, halo.messages_sent, halo.messages_received);
+}
 
-    if (iterations >= MAX_ITERATIONS)
+void SSSP::markAffectedSubtree(vertex_t root, Graph &graph)
+{
+    if (root < 0 || root >= static_cast<vertex_t>(dist.size()))
     {
-        std::cerr << "Warning: updateStep2 reached maximum iterations without converging" << std::endl;
+        std::cerr << "Error: Invalid root vertex " << root << std::endl;
+        return;
     }
-    else
+
+    std::queue<vertex_t> q;
+    q.push(root);
+    affected_del[root] = true;
+    affected[root] = true;
+
+    while (!q.empty())
     {
-        std::cout << "SSSP converged after " << iterations << " iterations." << std::endl;
+        vertex_t v = q.front();
+        q.pop();
+
+        graph.forEachNeighbor(v, [&](vertex_t c, float)
+                              {
+                                  if (c < 0 || c >= static_cast<vertex_t>(parent.size()))
+                                  {
+                                      return;
+                                  }
+
+                                  if (parent[c] == v)
+                                  {
+                                      dist[c] = std::numeric_limits<float>::infinity();
+                                      parent[c] = -1;
+                                      affected_del[c] = true;
+                                      affected[c] = true;
+                                      q.push(c);
+                                  } });
+    }
+}
+
+// Phase 1 under the task scheduler: each invalidated vertex becomes a task,
+// so deep subtrees and hubs are shared out instead of going level by level
+void SSSP::invalidateSubtrees(const Graph &graph, std::vector<vertex_t> &frontier, int rank)
+{
+    const float INF = std::numeric_limits<float>::infinity();
+    auto is_local = [&](vertex_t v)
+    { return graph.part.empty() || graph.part[v] == rank; };
+
+    scheduler.begin(true);
+    auto &invalidated = ws.threadLists(scheduler.workers.size());
+    for (vertex_t v : frontier)
+    {
+        affected_del[v] = false;
+        scheduler.spawn(graph, v);
+    }
+
+    scheduler.run([&](const NeighborTask &task, int thread)
+                  { graph.forEachNeighborInRange(task.vertex, task.begin, task.end, [&](vertex_t c, float)
+                                                 {
+                                                     // A vertex has a single parent, so exactly one task claims c
+                                                     if (is_local(c) && parent[c] == task.vertex)
+                                                     {
+                                                         dist[c] = INF;
+                                                         parent[c] = -1;
+                                                         affected[c] = true;
+                                                         invalidated[thread].push_back(c);
+                                                         scheduler.spawn(graph, c);
+                                                     } }); },
+                  true);
+
+    for (const auto &list : invalidated)
+    {
+        for (vertex_t c : list)
+            halo.markChanged(c);
     }
+    frontier.clear();
 }
 
-bool SSSP::hasConverged(MPI_Comm comm)
+// One level of Phase 1 on the devices. frontier holds ghosts that other
+// ranks invalidated; they and the vertices other devices invalidated last
+// round are seeded, then every device hands back what it changed and
+// invalidates the children of its invalid frontier vertices. pending says
+// whether that may have flagged anything.
+bool SSSP::invalidateOnDevices(std::vector<vertex_t> &frontier, bool &pending)
 {
-    int local_changed = 0;
+    const float INF = std::numeric_limits<float>::infinity();
+    auto &device_ids = ws.device_ids;
+    auto &device_dist = ws.device_dist;
+    auto &device_edges = ws.device_edges;
+    auto &cross_device = ws.cross_device;
+    device_ids.resize(devices.size());
+    device_dist.resize(devices.size());
+    device_edges.assign(devices.size(), 0);
+    for (size_t d = 0; d < devices.size(); d++)
+        device_ids[d].assign(frontier.begin(), frontier.end());
+    for (const auto &[v, from] : cross_device)
+    {
+        for (size_t d = 0; d < devices.size(); d++)
+        {
+            if (static_cast<int>(d) != from)
+                device_ids[d].push_back(v);
+        }
+    }
+    frontier.clear();
+    cross_device.clear();
 
-    for (bool a : affected)
+    pending = false;
+    for (size_t d = 0; d < devices.size(); d++)
     {
-        if (a)
+        if (!seedInvalid(opencl_ctx, devices[d], device_ids[d]) ||
+            !compactFrontier(opencl_ctx, devices[d], device_ids[d], device_dist[d], device_edges[d]))
+            return false;
+        pending = pending || !device_ids[d].empty();
+    }
+
+    // Mirror the invalidations of the device's own vertices; seeds come
+    // back too and are skipped
+    for (size_t d = 0; d < devices.size(); d++)
+    {
+        for (vertex_t v : device_ids[d])
         {
-            local_changed = 1;
-            break;
+            if (device_owner[v] != static_cast<cl_int>(d))
+                continue;
+            dist[v] = INF;
+            parent[v] = -1;
+            affected[v] = true;
+            affected_del[v] = true;
+            halo.markChanged(v);
+            if (device_boundary[v])
+                cross_device.push_back({v, static_cast<int>(d)});
         }
     }
 
-    int global_changed;
-    MPI_Allreduce(&local_changed, &global_changed, 1, MPI_INT, MPI_LOR, comm);
-    return global_changed == 0;
+    for (size_t d = 0; d < devices.size(); d++)
+    {
+        if (!invalidateFrontier(opencl_ctx, devices[d], device_ids[d].size()))
+            return false;
+    }
+    return true;
 }
 
-void SSSP::markAffectedSubtree(int root, Graph &graph)
+// Phase 2 in rounds. A push round queues the neighbour ranges of every
+// frontier vertex as scheduler tasks and lowers distances with atomic
+// compares; a pull round is used instead while the frontier is large (see
+// choosePull). The vertices a round improved form the next frontier, and
+// parents are only settled once the distances have converged. Boundary
+// changes go out between rounds, since MPI is only called from the master
+// thread.
+//
+// With use_device the rounds run on the OpenCL device. The host seeds it
+// with ghost distances and reads back each frontier, which keeps the host's
+// dist current for the boundary exchange and fixParents.
+void SSSP::relaxRounds(const Graph &graph, int rank, int &iterations, bool use_openmp, bool use_device)
 {
-    if (root < 0 || root >= static_cast<int>(dist.size()))
+    const float INF = std::numeric_limits<float>::infinity();
+
+    auto &repaired = ws.repaired;
+    repaired.clear();
+    for (vertex_t v : graph.local_vertices)
     {
-        std::cerr << "Error: Invalid root vertex " << root << std::endl;
-        return;
+        if (affected[v])
+        {
+            affected[v] = false;
+            affected_del[v] = false;
+            repaired.push_back(v);
+        }
     }
 
-    std::queue<int> q;
-    q.push(root);
-    affected_del[root] = true;
-    affected[root] = true;
+    // Pull: affected vertices take the best value their neighbours offer.
+    // When the devices hold the batch they pull there, and the improvements
+    // come back with the first compaction.
+    auto &device_ids = ws.device_ids;
+    auto &device_dist = ws.device_dist;
+    device_ids.resize(devices.size());
+    device_dist.resize(devices.size());
+    bool resident = use_device && device_resident, lost = false;
+    if (resident)
+    {
+        for (size_t d = 0; d < devices.size(); d++)
+            device_ids[d].clear();
+        for (vertex_t v : repaired)
+            device_ids[device_owner[v]].push_back(v);
+        for (size_t d = 0; resident && d < devices.size(); d++)
+            resident = pullVertices(opencl_ctx, devices[d], device_ids[d]);
+        lost = !resident;
+        if (lost)
+            std::cerr << "Warning: OpenCL pull failed, repairing on the CPU" << std::endl;
+    }
+    long long executed = 0, stolen = 0;
+    if (!resident)
+    {
+        scheduler.begin(use_openmp);
+        for (vertex_t v : repaired)
+            scheduler.spawn(graph, v);
+        scheduler.run([&](const NeighborTask &task, int)
+                      { graph.forEachNeighborInRange(task.vertex, task.begin, task.end, [&](vertex_t u, float weight)
+                                                     { lowerDist(dist[task.vertex], loadDist(dist[u]) + weight); }); },
+                      use_openmp);
+        executed = scheduler.executed;
+        stolen = scheduler.stolen;
+    }
 
-    while (!q.empty())
+    // Rounds then relax out of the vertices the previous round improved,
+    // starting from everything that now has a distance
+    auto &frontier = ws.frontier;
+    frontier.clear();
+    for (vertex_t v : repaired)
     {
-        int v = q.front();
-        q.pop();
+        if (dist[v] != INF)
+        {
+            halo.markChanged(v);
+            frontier.push_back(v);
+        }
+    }
 
-        for (const auto &neighbor : graph.adj[v])
+    // After a device failure the host starts over from every distance it
+    // has, which also covers the insertions only the devices applied. A
+    // zero-copy device may have lowered distances in place that the host
+    // never saw, so then every local one is announced and rechecked.
+    auto restart_on_host = [&]()
+    {
+        bool in_place = std::any_of(devices.begin(), devices.end(), [](const DeviceGraph &dev)
+                                    { return dev.zero_copy; });
+        frontier.clear();
+        for (const auto *list : {&graph.local_vertices, &graph.ghost_vertices})
+        {
+            for (vertex_t v : *list)
+            {
+                if (dist[v] != INF)
+                    frontier.push_back(v);
+            }
+        }
+        if (!in_place)
+            return;
+        for (vertex_t v : graph.local_vertices)
         {
-            int c = neighbor.first;
+            addRepaired(repaired, v);
+            if (dist[v] != INF)
+                halo.markChanged(v);
+        }
+    };
+    if (lost)
+        restart_on_host();
+
+    // affected doubles as "already listed this round"
+    auto &improved = ws.threadLists(scheduler.workers.size());
+    auto push = [&](const NeighborTask &task, int thread)
+    {
+        // The kernel's plain reads can only see a distance at or above the
+        // current one, so it never drops a real improvement
+        float d = loadDist(dist[task.vertex]);
+        relaxNeighbors(graph, task.vertex, task.begin, task.end, d, dist.data(), rank, [&](vertex_t v, float new_dist)
+                       {
+                           if (epsilon > 0 && !acceptable(d, new_dist, loadDist(dist[v])))
+                           {
+#pragma omp atomic
+                               skipped++;
+                           }
+                           else if (lowerDist(dist[v], new_dist) && claimFlag(affected[v]))
+                               improved[thread].push_back(v); });
+    };
+
+    edge_t local_edges = 0;
+#pragma omp parallel for reduction(+ : local_edges) if (use_openmp)
+    for (size_t i = 0; i < graph.local_vertices.size(); i++)
+        local_edges += graph.degree(graph.local_vertices[i]);
+
+    // On the devices the frontier vector only holds what the host adds
+    // (seeds and ghost updates); device_pending says whether the last
+    // device round may have improved anything. Devices hear about each
+    // other's improvements through the host, one round later, the way
+    // ranks do through the halo exchange.
+    bool on_device = resident || (use_device && !lost && uploadToDevices());
+    bool device_pending = resident;
+    auto &cross_device = ws.cross_device;
+    cross_device.clear();
+    device_resident = false;
 
-            if (c < 0 || c >= static_cast<int>(parent.size()))
+    auto &arrived = ws.arrived;
+    bool converged = false, pulling = false;
+    int push_rounds = 0, pull_rounds = 0;
+    halo.end();
+    halo.begin(1);
+    termination.reset();
+    while (!converged)
+    {
+        if (on_device && (device_pending || !frontier.empty()))
+        {
+            iterations++;
+            for (size_t d = 0; d < devices.size(); d++)
             {
-                continue;
+                device_ids[d].assign(frontier.begin(), frontier.end());
+                device_dist[d].clear();
+                for (vertex_t v : frontier)
+                    device_dist[d].push_back(dist[v]);
+            }
+            for (const auto &[v, from] : cross_device)
+            {
+                for (size_t d = 0; d < devices.size(); d++)
+                {
+                    if (static_cast<int>(d) != from)
+                    {
+                        device_ids[d].push_back(v);
+                        device_dist[d].push_back(dist[v]);
+                    }
+                }
+            }
+            frontier.clear();
+            cross_device.clear();
+
+            bool ok = true;
+            for (size_t d = 0; ok && d < devices.size(); d++)
+                ok = seedFrontier(opencl_ctx, devices[d], device_ids[d], device_dist[d]);
+
+            size_t frontier_size = 0;
+            edge_t frontier_edges = 0;
+            std::vector<cl_uint> &device_edges = ws.device_edges;
+            device_edges.assign(devices.size(), 0);
+            for (size_t d = 0; ok && d < devices.size(); d++)
+            {
+                ok = compactFrontier(opencl_ctx, devices[d], device_ids[d], device_dist[d], device_edges[d]);
+                frontier_size += device_ids[d].size();
+                frontier_edges += device_edges[d];
             }
 
-            if (parent[c] == v)
+            if (ok)
             {
-                dist[c] = std::numeric_limits<float>::infinity();
-                parent[c] = -1;
-                affected_del[c] = true;
-                affected[c] = true;
-                q.push(c);
+                // Seeds come back unchanged; only device improvements are news.
+                // A zero-copy device has written them into dist already, so
+                // everything it owns counts, seeds included.
+                for (size_t d = 0; d < devices.size(); d++)
+                {
+                    for (size_t i = 0; i < device_ids[d].size(); i++)
+                    {
+                        vertex_t v = device_ids[d][i];
+                        if (device_owner[v] != static_cast<cl_int>(d))
+                            continue;
+                        if (devices[d].zero_copy || device_dist[d][i] < dist[v])
+                        {
+                            dist[v] = device_dist[d][i];
+                            halo.markChanged(v);
+                            addRepaired(repaired, v);
+                            if (device_boundary[v])
+                                cross_device.push_back({v, static_cast<int>(d)});
+                        }
+                    }
+                }
+
+                device_pending = frontier_size > 0;
+                if (device_pending)
+                {
+                    pulling = choosePull(direction, pulling, frontier_size, frontier_edges,
+                                         graph.local_vertices.size(), local_edges);
+                    for (size_t d = 0; ok && d < devices.size(); d++)
+                        ok = relaxFrontier(opencl_ctx, devices[d], pulling, device_ids[d].size(), device_edges[d]);
+                    (pulling ? pull_rounds : push_rounds)++;
+                }
+            }
+
+            if (!ok)
+            {
+                // Whatever the devices improved since the last frontier is
+                // lost to the host
+                std::cerr << "Warning: OpenCL relaxation failed, finishing on the CPU" << std::endl;
+                on_device = device_pending = false;
+                restart_on_host();
             }
         }
+        else if (!frontier.empty())
+        {
+            iterations++;
+            edge_t frontier_edges = 0;
+#pragma omp parallel for reduction(+ : frontier_edges) if (use_openmp)
+            for (size_t i = 0; i < frontier.size(); i++)
+                frontier_edges += graph.degree(frontier[i]);
+
+            pulling = choosePull(direction, pulling, frontier.size(), frontier_edges,
+                                 graph.local_vertices.size(), local_edges);
+            if (pulling)
+            {
+                pullRound(graph, improved, scheduler.workers.size());
+                pull_rounds++;
+            }
+            else
+            {
+                scheduler.begin(use_openmp);
+                for (vertex_t v : frontier)
+                    scheduler.spawn(graph, v);
+                scheduler.run(push, use_openmp);
+                executed += scheduler.executed;
+                stolen += scheduler.stolen;
+                push_rounds++;
+            }
+
+            frontier.clear();
+            for (auto &list : improved)
+            {
+                for (vertex_t v : list)
+                {
+                    affected[v] = false;
+                    halo.markChanged(v);
+                    addRepaired(repaired, v);
+                    frontier.push_back(v);
+                }
+                list.clear();
+            }
+        }
+
+        halo.flush(dist);
+        arrived.clear();
+        halo.poll(arrived);
+        for (const auto &update : arrived)
+        {
+            dist[update.vertex] = update.dist;
+            frontier.push_back(update.vertex);
+        }
+
+        converged = hasConverged(comm, !frontier.empty() || device_pending);
+    }
+    halo.end();
+
+    fixParents(graph, repaired, use_openmp);
+    if (use_device)
+    {
+        std::cout << "OpenCL: " << push_rounds << " push / " << pull_rounds << " pull rounds on "
+                  << devices.size() << " device(s)" << std::endl;
+        // Rounds too short to time leave the previous estimate in place
+        for (size_t d = 0; d < devices.size(); d++)
+        {
+            if (devices[d].busy_seconds > 0)
+                device_speed[d] = devices[d].relaxed_edges / devices[d].busy_seconds;
+            if (devices.size() > 1)
+                std::cout << "  device " << d << ": " << device_local[d].size() << " vertices, "
+                          << device_speed[d] / 1e6 << " M edges/s" << std::endl;
+            // Buffers over the host arrays must not outlive them, and the
+            // arrays may be reallocated before the next batch
+            if (devices[d].zero_copy)
+                releaseDeviceGraph(devices[d]);
+        }
     }
-}
\ No newline at end of file
+    else
+        std::cout << "Task scheduler: " << executed << " tasks on " << scheduler.workers.size()
+                  << " threads, " << stolen << " stolen; " << push_rounds << " push / "
+                  << pull_rounds << " pull rounds" << std::endl;
+}
+
+// One pull round: every local vertex takes the minimum over its neighbours.
+// Each vertex is written only by the thread that pulls it, so unlike a push
+// round this needs atomic loads and stores but no compare-and-swap.
+void SSSP::pullRound(const Graph &graph, std::vector<placed_vector<vertex_t>> &improved, size_t threads)
+{
+#pragma omp parallel for schedule(dynamic, 64) num_threads(threads)
+    for (size_t i = 0; i < graph.local_vertices.size(); i++)
+    {
+        vertex_t v = graph.local_vertices[i];
+        // best_slack applies epsilon per edge, as a push would
+        float best = dist[v], best_slack = dist[v];
+        graph.forEachNeighbor(v, [&](vertex_t u, float weight)
+                              {
+                                  float du = loadDist(dist[u]);
+                                  best = std::min(best, du + weight);
+                                  best_slack = std::min(best_slack, du + (1 + epsilon) * weight); });
+        if (best < dist[v] && best_slack >= dist[v])
+        {
+#pragma omp atomic
+            skipped++;
+        }
+        else if (best < dist[v])
+        {
+            storeDist(dist[v], best);
+            improved[omp_get_thread_num()].push_back(v);
+        }
+    }
+}
+
+// Points every repaired vertex at a neighbour that realises its distance.
+// Ghost distances are final once termination has been detected, and the
+// sums are the same float additions the relaxation did, so a match exists
+// for every reachable vertex but the source. With epsilon a neighbour may
+// have improved by less than the skip threshold since; then the closest
+// strictly nearer one is taken.
+void SSSP::fixParents(const Graph &graph, std::vector<vertex_t> &repaired, bool use_openmp)
+{
+    std::sort(repaired.begin(), repaired.end());
+    repaired.erase(std::unique(repaired.begin(), repaired.end()), repaired.end());
+
+#pragma omp parallel for schedule(dynamic, 64) if (use_openmp)
+    for (size_t i = 0; i < repaired.size(); i++)
+    {
+        vertex_t v = repaired[i];
+        vertex_t best = -1;
+        if (dist[v] != std::numeric_limits<float>::infinity())
+        {
+            graph.forEachNeighbor(v, [&](vertex_t u, float weight)
+                                  {
+                                      if (best < 0 && dist[u] + weight == dist[v])
+                                          best = u; });
+        }
+        if (best < 0 && epsilon > 0 && dist[v] != std::numeric_limits<float>::infinity())
+        {
+            float closest = std::numeric_limits<float>::infinity();
+            graph.forEachNeighbor(v, [&](vertex_t u, float weight)
+                                  {
+                                      if (dist[u] < dist[v] && dist[u] + weight < closest)
+                                      {
+                                          closest = dist[u] + weight;
+                                          best = u;
+                                      } });
+        }
+        parent[v] = best;
+    }
+}
@@ -4,34 +4,117 @@
 
 #include "graph.h"
 #include "opencl_utils.h"
+#include "halo_exchange.h"
+#include "termination.h"
+#include "numa_utils.h"
+#include "task_scheduler.h"
+#include "workspace.h"
 #include <vector>
 #include <mpi.h>
 
+// Direction of the relaxation rounds in Step 2. RELAX_AUTO picks push or
+// pull per round from the frontier's size.
+enum RelaxDirection
+{
+    RELAX_AUTO,
+    RELAX_PUSH,
+    RELAX_PULL
+};
+
 class SSSP
 {
 public:
-    std::vector<float> dist;
-    std::vector<int> parent;
-    std::vector<bool> affected;
-    std::vector<bool> affected_del;
+    // Per-vertex state, first-touched in parallel (see numa_utils.h).
+    // Flags are bytes so threads can set them independently.
+    placed_vector<float> dist;
+    placed_vector<vertex_t> parent;
+    placed_vector<char> affected;
+    placed_vector<char> affected_del;
 
     // OpenCL data structures
     bool opencl_available = false;
     OpenCLContext opencl_ctx;
-    std::vector<std::pair<int, int>> edge_pairs;
-    std::vector<float> edge_weights;
+    placed_vector<cl_uint> csr_offsets;
+    placed_vector<cl_int> csr_targets;
+    placed_vector<float> csr_weights;
+
+    // The rank's vertices split across the context's devices, weighted by
+    // device_speed (relaxed edges per second, measured in earlier batches)
+    std::vector<DeviceGraph> devices;
+    std::vector<double> device_speed;
+    placed_vector<cl_int> device_owner;            // Device of each local vertex, -1 otherwise
+    std::vector<std::vector<cl_int>> device_local; // Vertices of each device
+    std::vector<char> device_boundary;             // Has a neighbour on another device
+
+    // Step 1 ran on the devices, which hold this batch's distances and
+    // parents until relaxRounds finishes; the host arrays catch up as
+    // changed vertices are compacted back
+    bool device_resident = false;
+
+    // Boundary exchange with neighbouring ranks
+    MPI_Comm comm = MPI_COMM_WORLD;
+    HaloExchange halo;
+    TerminationDetector termination;
+
+    // Step 2 with OpenMP runs as work-stealing tasks
+    TaskScheduler scheduler;
+    RelaxDirection direction = RELAX_AUTO;
+
+    // Scratch reused across rounds and batches
+    Workspace ws;
+
+    // Approximate mode: a relaxation over an edge of weight w only goes in
+    // if it beats the current distance by more than epsilon * w, so every
+    // edge keeps dist[v] <= dist[u] + (1 + epsilon) * w and, summed along
+    // a shortest path, every distance stays within 1 + epsilon of exact.
+    // Deleted tree edges may be re-parented (see resolveTreeEdges). The
+    // OpenCL kernels always relax exactly.
+    float epsilon = 0;
+
+    // Counters for the last batch: tree-edge changes absorbed by exact
+    // re-parenting, cut-off children moved to a detour, and relaxations
+    // skipped as too small
+    long long reparented = 0;
+    long long spared = 0;
+    long long skipped = 0;
+
+    // Whether new_dist, reached from a vertex at distance from, is worth
+    // taking over current: (from + (1 + epsilon) * weight) < current
+    bool acceptable(float from, float new_dist, float current) const
+    {
+        return new_dist + epsilon * (new_dist - from) < current;
+    }
 
-    SSSP(int V);
-    void initialize(int source);
+    SSSP(vertex_t V);
+    ~SSSP();
+    SSSP(const SSSP &) = delete;
+    SSSP &operator=(const SSSP &) = delete;
+    void resize(vertex_t V, bool use_openmp = false);
+    void initialize(vertex_t source, bool use_openmp = false);
     void updateStep1(const Graph &graph, const std::vector<Edge> &inserts,
-                     const std::vector<Edge> &deletes, bool use_openmp);
+                     const std::vector<Edge> &deletes, const std::vector<Edge> &increases,
+                     bool use_openmp, bool use_opencl = false);
+    const std::vector<Edge> &resolveTreeEdges(const Graph &graph, const std::vector<Edge> &deletes,
+                                              const std::vector<Edge> &increases, int rank, bool detours);
+    void applyUpdatesOnHost(const Graph &graph, const std::vector<Edge> &inserts,
+                            const std::vector<Edge> &deletes, int rank, bool use_openmp);
+    bool applyUpdatesOnDevices(const Graph &graph, const std::vector<Edge> &inserts,
+                               const std::vector<Edge> &deletes);
     void updateStep2(Graph &graph, bool use_openmp, int async_level, bool use_opencl = false);
-    void updateStep2CPU(Graph &graph, bool use_openmp, int async_level); // Added declaration
-    bool hasConverged(MPI_Comm comm);
-    void markAffectedSubtree(int root, Graph &graph);
+    void updateStep2CPU(Graph &graph, bool use_openmp, int async_level, bool use_device = false); // Added declaration
+    bool hasConverged(MPI_Comm comm, bool local_active);
+    void markAffectedSubtree(vertex_t root, Graph &graph);
+    void invalidateSubtrees(const Graph &graph, std::vector<vertex_t> &frontier, int rank);
+    bool invalidateOnDevices(std::vector<vertex_t> &frontier, bool &pending);
+    void relaxRounds(const Graph &graph, int rank, int &iterations, bool use_openmp, bool use_device);
+    void pullRound(const Graph &graph, std::vector<placed_vector<vertex_t>> &improved, size_t threads);
+    void fixParents(const Graph &graph, std::vector<vertex_t> &repaired, bool use_openmp);
 
-    // New method to prepare graph data for OpenCL
-    void prepareGraphForOpenCL(const Graph &graph);
+    // New method to prepare graph data for OpenCL; false if the device
+    // cannot take this graph
+    bool prepareGraphForOpenCL(const Graph &graph);
+    void splitAcrossDevices(const Graph &graph);
+    bool uploadToDevices();
 };
 
 #endif // SSSP_H
\ No newline at end of file
@@ -0,0 +1,17 @@
+#ifndef SSSP_TYPES_H
+#define SSSP_TYPES_H
+
+#include <cstdint>
+
+// Vertex IDs are 32-bit unless built with -DSSSP_64BIT_IDS; edge counts
+// and offsets are always 64-bit
+#ifdef SSSP_64BIT_IDS
+typedef int64_t vertex_t;
+#define MPI_VERTEX_T MPI_INT64_T
+#else
+typedef int32_t vertex_t;
+#define MPI_VERTEX_T MPI_INT32_T
+#endif
+typedef int64_t edge_t;
+
+#endif // SSSP_TYPES_H
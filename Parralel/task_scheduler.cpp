@@ -0,0 +1,127 @@
+#include "task_scheduler.h"
+#include <algorithm>
+#include <thread>
+
+void TaskQueue::push_back(const NeighborTask &task)
+{
+    if (count == slots.size())
+    {
+        std::vector<NeighborTask> grown(std::max<size_t>(64, 2 * slots.size()));
+        for (size_t i = 0; i < count; i++)
+            grown[i] = slots[(head + i) & (slots.size() - 1)];
+        slots.swap(grown);
+        head = 0;
+    }
+    slots[(head + count) & (slots.size() - 1)] = task;
+    count++;
+}
+
+NeighborTask TaskQueue::pop_front()
+{
+    NeighborTask task = slots[head];
+    head = (head + 1) & (slots.size() - 1);
+    count--;
+    return task;
+}
+
+NeighborTask TaskQueue::pop_back()
+{
+    count--;
+    return slots[(head + count) & (slots.size() - 1)];
+}
+
+TaskScheduler::Worker::Worker() : seed(0)
+{
+    omp_init_lock(&lock);
+}
+
+TaskScheduler::Worker::~Worker()
+{
+    omp_destroy_lock(&lock);
+}
+
+void TaskScheduler::begin(bool use_openmp)
+{
+    size_t threads = use_openmp ? omp_get_max_threads() : 1;
+    if (workers.size() != threads)
+    {
+        workers = std::vector<Worker>(threads);
+        for (size_t t = 0; t < threads; t++)
+            workers[t].seed = 2654435761u * (t + 1);
+    }
+    outstanding.store(0);
+    next_seed = 0;
+}
+
+void TaskScheduler::spawn(const Graph &graph, vertex_t v)
+{
+    edge_t degree = graph.degree(v);
+    // Compressed lists can only be decoded from the start, so they stay whole
+    edge_t step = graph.compressed ? std::max<edge_t>(degree, 1) : grain;
+    for (edge_t begin = 0; begin < degree; begin += step)
+    {
+        NeighborTask task = {v, begin, std::min(degree, begin + step)};
+        if (omp_in_parallel())
+            push(omp_get_thread_num(), task);
+        else
+            push(next_seed++ % workers.size(), task);
+    }
+}
+
+void TaskScheduler::push(int thread, const NeighborTask &task)
+{
+    // Counted before it becomes visible, so outstanding never reads zero
+    // while work is still queued
+    outstanding.fetch_add(1, std::memory_order_acq_rel);
+    Worker &w = workers[thread];
+    omp_set_lock(&w.lock);
+    w.tasks.push_back(task);
+    omp_unset_lock(&w.lock);
+}
+
+bool TaskScheduler::pop(int thread, NeighborTask &task)
+{
+    Worker &w = workers[thread];
+    omp_set_lock(&w.lock);
+    bool found = !w.tasks.empty();
+    if (found)
+    {
+        task = w.tasks.pop_front();
+    }
+    omp_unset_lock(&w.lock);
+    return found;
+}
+
+bool TaskScheduler::steal(int thread, NeighborTask &task)
+{
+    size_t n = workers.size();
+    if (n < 2)
+        return false;
+
+    // Start at a random victim so thieves spread out
+    unsigned &seed = workers[thread].seed;
+    seed = seed * 1103515245u + 12345u;
+    size_t start = (seed >> 16) % n;
+    for (size_t i = 0; i < n; i++)
+    {
+        size_t victim = (start + i) % n;
+        if (victim == static_cast<size_t>(thread))
+            continue;
+        Worker &w = workers[victim];
+        omp_set_lock(&w.lock);
+        bool found = !w.tasks.empty();
+        if (found)
+        {
+            task = w.tasks.pop_back();
+        }
+        omp_unset_lock(&w.lock);
+        if (found)
+            return true;
+    }
+    return false;
+}
+
+void TaskScheduler::idle()
+{
+    std::this_thread::yield();
+}
@@ -0,0 +1,104 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include "graph.h"
+#include <atomic>
+#include <vector>
+#include <omp.h>
+
+// The slice [begin, end) of one vertex's neighbour list
+struct NeighborTask
+{
+    vertex_t vertex;
+    edge_t begin, end;
+};
+
+// Growable ring buffer serving as a worker's deque. std::deque hands its
+// blocks back as it drains, so every round would allocate again; this one
+// keeps its storage once it has grown to the largest round seen.
+struct TaskQueue
+{
+    std::vector<NeighborTask> slots; // Size is zero or a power of two
+    size_t head = 0;
+    size_t count = 0;
+
+    bool empty() const { return count == 0; }
+    void push_back(const NeighborTask &task);
+    NeighborTask pop_front();
+    NeighborTask pop_back();
+};
+
+// Work-stealing scheduler for the irregular parts of Step 2. Every OpenMP
+// thread owns a deque; a thread that runs dry steals from the others, so a
+// hub or a deep subtree no longer holds up a whole parallel loop. Vertices
+// with more than grain neighbours are split into several tasks.
+//
+// Owners take the oldest task of their own deque, which keeps relaxation
+// roughly in distance order; thieves take the newest of a victim's deque,
+// so the two ends rarely contend.
+class TaskScheduler
+{
+public:
+    struct alignas(64) Worker
+    {
+        omp_lock_t lock;
+        TaskQueue tasks;
+        unsigned seed;
+
+        Worker();
+        ~Worker();
+        Worker(const Worker &) = delete;
+        Worker &operator=(const Worker &) = delete;
+    };
+
+    edge_t grain = 256;
+    std::vector<Worker> workers;
+    std::atomic<long long> outstanding{0};
+    size_t next_seed = 0;
+
+    long long executed = 0; // Tasks run by the last run()
+    long long stolen = 0;   // ... of which were stolen
+
+    // Sizes the deques for the team run() will use
+    void begin(bool use_openmp);
+
+    // Queues v's neighbour list, split into ranges of at most grain entries.
+    // Inside run() tasks go to the calling thread's deque; outside, seeds are
+    // dealt round-robin so every thread starts with work.
+    void spawn(const Graph &graph, vertex_t v);
+
+    // Runs execute(task, thread) until every queued task, and everything
+    // those spawned, has finished
+    template <typename F>
+    void run(F &&execute, bool use_openmp)
+    {
+        long long total_executed = 0, total_stolen = 0;
+#pragma omp parallel num_threads(workers.size()) if (use_openmp) reduction(+ : total_executed, total_stolen)
+        {
+            int me = omp_get_thread_num();
+            NeighborTask task;
+            while (outstanding.load(std::memory_order_acquire) > 0)
+            {
+                bool mine = pop(me, task);
+                if (!mine && !steal(me, task))
+                {
+                    idle();
+                    continue;
+                }
+                execute(task, me);
+                total_executed++;
+                total_stolen += !mine;
+                outstanding.fetch_sub(1, std::memory_order_acq_rel);
+            }
+        }
+        executed = total_executed;
+        stolen = total_stolen;
+    }
+
+    void push(int thread, const NeighborTask &task);
+    bool pop(int thread, NeighborTask &task);
+    bool steal(int thread, NeighborTask &task);
+    void idle();
+};
+
+#endif // TASK_SCHEDULER_H
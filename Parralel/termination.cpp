@@ -0,0 +1,40 @@
+#include "termination.h"
+
+void TerminationDetector::reset()
+{
+    if (request != MPI_REQUEST_NULL)
+    {
+        MPI_Wait(&request, MPI_STATUS_IGNORE);
+    }
+    previous[0] = previous[1] = -1;
+    waves = 0;
+}
+
+bool TerminationDetector::poll(MPI_Comm comm, bool idle, long long sent, long long received)
+{
+    if (request != MPI_REQUEST_NULL)
+    {
+        int done = 0;
+        MPI_Test(&request, &done, MPI_STATUS_IGNORE);
+        if (!done)
+            return false;
+
+        // All ranks see the same totals, so they all stop on the same wave
+        if (totals[0] == totals[1] &&
+            totals[0] == previous[0] && totals[1] == previous[1])
+        {
+            return true;
+        }
+        previous[0] = totals[0];
+        previous[1] = totals[1];
+    }
+
+    if (idle)
+    {
+        counts[0] = sent;
+        counts[1] = received;
+        MPI_Iallreduce(counts, totals, 2, MPI_LONG_LONG, MPI_SUM, comm, &request);
+        waves++;
+    }
+    return false;
+}
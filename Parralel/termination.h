@@ -0,0 +1,24 @@
+#ifndef TERMINATION_H
+#define TERMINATION_H
+
+#include <mpi.h>
+
+// Distributed termination detection using Mattern's four-counter method.
+// Each wave is a non-blocking MPI_Iallreduce of the message counters that a
+// rank joins only while it is idle; ranks keep relaxing incoming work while
+// a wave is in progress. The computation has terminated once two consecutive
+// waves see identical totals with every sent message also received.
+class TerminationDetector
+{
+public:
+    MPI_Request request = MPI_REQUEST_NULL;
+    long long counts[2] = {0, 0};
+    long long totals[2] = {0, 0};
+    long long previous[2] = {-1, -1};
+    int waves = 0;
+
+    void reset();
+    bool poll(MPI_Comm comm, bool idle, long long sent, long long received);
+};
+
+#endif // TERMINATION_H
@@ -0,0 +1,125 @@
+#include <iostream>
+#include <map>
+#include <utility>
+#include <vector>
+#include <mpi.h>
+#include "dynamic_sssp.h"
+#include "numa_utils.h"
+
+// Checks that update batches stop allocating once the workspace has warmed
+// up. Build with -DSSSP_COUNT_ALLOCS and run on one or more ranks:
+//
+//   mpirun -np 2 ./alloc_test
+//
+// A grid graph gets the same cycle of batches again and again: tree edges
+// deleted, the same edges inserted back, then made heavier and restored.
+// None of it grows the graph, so after the first cycle Step 1, Step 2 and
+// publishing must not touch the heap on any rank. Only those stages are
+// counted: coalescing, distributing and planning the batch and applying it
+// to the adjacency still allocate and are not checked here.
+
+static const vertex_t SIDE = 64;
+static const int CYCLES = 4;
+
+static std::vector<Edge> gridGraph()
+{
+    std::vector<Edge> edges;
+    for (vertex_t r = 0; r < SIDE; r++)
+    {
+        for (vertex_t c = 0; c < SIDE; c++)
+        {
+            vertex_t v = r * SIDE + c;
+            float weight = 1 + (v * 7919) % 13;
+            if (c + 1 < SIDE)
+                edges.push_back({v, v + 1, weight});
+            if (r + 1 < SIDE)
+                edges.push_back({v, v + SIDE, weight + 2});
+        }
+    }
+    return edges;
+}
+
+// Runs the batch cycles; returns the number of batches after the first
+// cycle that allocated
+static int checkBatches(bool use_openmp, int rank)
+{
+    DynamicSSSPOptions options;
+    options.use_openmp = use_openmp;
+    options.cost_model = false; // Always the incremental path
+    DynamicSSSP engine(MPI_COMM_WORLD, options);
+
+    std::vector<Edge> edges = gridGraph();
+    std::map<std::pair<vertex_t, vertex_t>, float> weights;
+    for (const Edge &e : edges)
+        weights[{e.u, e.v}] = weights[{e.v, e.u}] = e.weight;
+    if (!engine.buildGraph(SIDE * SIDE, edges) || !engine.setSource(0))
+        return -1;
+
+    // Tree edges into every 37th vertex, picked once from the initial tree
+    std::vector<Edge> cut;
+    for (vertex_t v = 1; v < SIDE * SIDE; v += 37)
+    {
+        vertex_t p = engine.parentOf(v);
+        if (p >= 0)
+            cut.push_back({v, p, weights[{v, p}]});
+    }
+
+    int failures = 0;
+    for (int cycle = 0; cycle < CYCLES; cycle++)
+    {
+        std::vector<Edge> deleted = cut, heavier = cut;
+        for (Edge &e : deleted)
+            e.weight = -1;
+        for (Edge &e : heavier)
+            e.weight *= 3;
+        for (const std::vector<Edge> *batch : {&deleted, &cut, &heavier, &cut})
+        {
+            // Updates are read on rank 0 only
+            BatchStats stats = engine.applyBatch(rank == 0 ? *batch : std::vector<Edge>());
+            if (stats.allocations < 0)
+            {
+                if (rank == 0)
+                    std::cerr << "alloc_test: build with -DSSSP_COUNT_ALLOCS" << std::endl;
+                return -1;
+            }
+            if (cycle > 0 && stats.allocations > 0)
+            {
+                failures++;
+                if (rank == 0)
+                    std::cerr << "alloc_test: " << (use_openmp ? "OpenMP" : "sequential") << " cycle " << cycle
+                              << ": " << stats.allocations << " allocations" << std::endl;
+            }
+        }
+    }
+    return failures;
+}
+
+int main(int argc, char **argv)
+{
+    MPI_Init(&argc, &argv);
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    int failures = 0;
+    for (bool use_openmp : {false, true})
+    {
+        int result = checkBatches(use_openmp, rank);
+        if (result < 0)
+        {
+            failures = -1;
+            break;
+        }
+        failures += result;
+    }
+
+    if (rank == 0)
+    {
+        if (failures == 0)
+            std::cout << "alloc_test: no allocations after warm-up on " << size << " ranks" << std::endl;
+        else if (failures > 0)
+            std::cout << "alloc_test: " << failures << " batches allocated after warm-up" << std::endl;
+    }
+    MPI_Finalize();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+#include <mpi.h>
+#include "dynamic_sssp.h"
+
+// Checks that approximate batches stay within 1 + epsilon of the exact
+// distances. Run on one or more ranks:
+//
+//   mpirun -np 2 ./epsilon_test
+//
+// A random graph gets the same random batches of insertions, deletions and
+// weight changes in an exact engine and in approximate ones, with and
+// without OpenMP; after every
+// batch each distance must lie between the exact one and (1 + epsilon)
+// times it, give or take float rounding.
+
+static const vertex_t VERTICES = 3000;
+static const int EDGES = 9000;
+static const int BATCHES = 8;
+static const int BATCH_SIZE = 50;
+
+int main(int argc, char **argv)
+{
+    MPI_Init(&argc, &argv);
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    // Every rank draws the same graph and batches; only rank 0's are read
+    std::mt19937 rng(2024);
+    std::uniform_int_distribution<vertex_t> vertex(0, VERTICES - 1);
+    std::uniform_real_distribution<float> weight(1, 20);
+    std::map<std::pair<vertex_t, vertex_t>, float> edges;
+    for (vertex_t v = 1; v < VERTICES; v++) // A spanning path keeps most of it reachable
+        edges[{v - 1, v}] = weight(rng);
+    while (static_cast<int>(edges.size()) < EDGES)
+    {
+        vertex_t u = vertex(rng), v = vertex(rng);
+        if (u != v)
+            edges[{std::min(u, v), std::max(u, v)}] = weight(rng);
+    }
+    std::vector<Edge> graph;
+    for (const auto &[ends, w] : edges)
+        graph.push_back({ends.first, ends.second, w});
+
+    std::vector<std::vector<Edge>> batches(BATCHES);
+    for (auto &batch : batches)
+    {
+        while (static_cast<int>(batch.size()) < BATCH_SIZE)
+        {
+            auto it = std::next(edges.begin(), std::uniform_int_distribution<size_t>(0, edges.size() - 1)(rng));
+            Edge e = {it->first.first, it->first.second, 0};
+            switch (rng() % 3)
+            {
+            case 0: // Deletion
+                e.weight = -1;
+                edges.erase(it);
+                break;
+            case 1: // Heavier or lighter
+                e.weight = it->second = weight(rng);
+                break;
+            default: // Insertion
+                e.u = vertex(rng);
+                e.v = vertex(rng);
+                if (e.u == e.v || edges.count({std::min(e.u, e.v), std::max(e.u, e.v)}))
+                    continue;
+                e.weight = edges[{std::min(e.u, e.v), std::max(e.u, e.v)}] = weight(rng);
+            }
+            batch.push_back(e);
+        }
+    }
+
+    auto solve = [&](float epsilon, bool use_openmp)
+    {
+        DynamicSSSPOptions options;
+        options.epsilon = epsilon;
+        options.use_openmp = use_openmp;
+        options.cost_model = false; // Always the incremental path
+        std::vector<std::vector<float>> dist;
+        DynamicSSSP engine(MPI_COMM_WORLD, options);
+        if (!engine.buildGraph(VERTICES, rank == 0 ? graph : std::vector<Edge>()) || !engine.setSource(0))
+            return dist;
+        for (const auto &batch : batches)
+        {
+            engine.applyBatch(rank == 0 ? batch : std::vector<Edge>());
+            dist.push_back(engine.distances());
+        }
+        return dist;
+    };
+
+    int failures = 0;
+    std::vector<std::vector<float>> exact = solve(0, false);
+    for (auto [epsilon, use_openmp] : {std::pair<float, bool>{0.1f, false}, {0.2f, false}, {0.1f, true}, {0.2f, true}})
+    {
+        std::vector<std::vector<float>> approx = solve(epsilon, use_openmp);
+        if (approx.size() != exact.size())
+        {
+            failures++;
+            continue;
+        }
+        double worst = 0;
+        for (size_t b = 0; b < exact.size(); b++)
+        {
+            for (vertex_t v = 0; v < VERTICES; v++)
+            {
+                float want = exact[b][v], got = approx[b][v];
+                if (std::isinf(want) || std::isinf(got))
+                {
+                    failures += std::isinf(want) != std::isinf(got);
+                    continue;
+                }
+                if (want > 0)
+                    worst = std::max(worst, (double(got) - want) / want);
+                if (got < want * (1 - 1e-5f) || got > want * (1 + epsilon) * (1 + 1e-5f))
+                    failures++;
+            }
+        }
+        if (rank == 0)
+            std::cout << "epsilon_test: epsilon " << epsilon << (use_openmp ? " (OpenMP)" : "")
+                      << ", max relative error " << worst << std::endl;
+    }
+
+    if (rank == 0)
+    {
+        if (failures == 0)
+            std::cout << "epsilon_test: all distances within the bound on " << size << " ranks" << std::endl;
+        else
+            std::cout << "epsilon_test: " << failures << " distances outside the bound" << std::endl;
+    }
+    MPI_Finalize();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,109 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "update_ring.h"
+#include "utils.h"
+
+// Streams update files into the shared-memory ring of an sssp process
+// started with --ring=<name>. Every file is one batch unless --batch=<n>
+// splits it; "-" reads standard input. Lines use the updates file format.
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0]
+                  << " <ring_name> <updates_file|-> [updates_file ...] [--batch=<n>] [--timeout=<seconds>]" << std::endl;
+        return 1;
+    }
+
+    std::string ring_name = argv[1];
+    std::vector<std::string> files;
+    long long batch_size = 0;
+    int timeout = 30;
+    for (int i = 2; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        try
+        {
+            if (arg.compare(0, 8, "--batch=") == 0)
+                batch_size = std::stoll(arg.substr(8));
+            else if (arg.compare(0, 10, "--timeout=") == 0)
+                timeout = std::stoi(arg.substr(10));
+            else if (arg == "-" || arg.compare(0, 2, "--") != 0)
+                files.push_back(arg);
+            else
+                std::cerr << "Warning: Unknown option '" << arg << "'" << std::endl;
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Warning: Invalid value in '" << arg << "', ignored" << std::endl;
+        }
+    }
+
+    UpdateRing ring;
+    if (!ring.attach(ring_name, timeout * 1000))
+        return 1;
+
+    auto start = std::chrono::steady_clock::now();
+    long long sent = 0, batches = 0, skipped = 0;
+    bool open = true;
+    for (const std::string &filename : files)
+    {
+        std::ifstream file;
+        if (filename != "-")
+        {
+            file.open(filename);
+            if (!file.is_open())
+            {
+                std::cerr << "Error opening updates file: " << filename << std::endl;
+                continue;
+            }
+        }
+        std::istream &in = filename == "-" ? std::cin : file;
+
+        long long in_batch = 0;
+        std::string line;
+        while (open && std::getline(in, line))
+        {
+            Edge e;
+            const char *error;
+            if (!parseUpdateLine(line, e, error))
+            {
+                if (error)
+                    skipped++;
+                continue;
+            }
+            open = ring.push(e);
+            if (!open)
+                break;
+            sent++;
+            if (batch_size > 0 && ++in_batch == batch_size)
+            {
+                open = ring.endBatch();
+                batches++;
+                in_batch = 0;
+            }
+        }
+        if (open && (in_batch > 0 || batch_size <= 0))
+        {
+            open = ring.endBatch();
+            batches++;
+        }
+        if (!open)
+        {
+            std::cerr << "Error: The consumer of " << ring_name << " has gone" << std::endl;
+            return 1;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Sent " << sent << " updates in " << batches << " batches in " << seconds << " seconds ("
+              << ring.producerStalls() << " waits for a full ring";
+    if (skipped > 0)
+        std::cout << ", " << skipped << " malformed lines skipped";
+    std::cout << ")" << std::endl;
+    ring.close();
+    return 0;
+}
@@ -0,0 +1,262 @@
+#include "tree_index.h"
+#include <algorithm>
+
+void TreeIndex::link(vertex_t v)
+{
+    vertex_t p = parent[v];
+    prev_sibling[v] = -1;
+    next_sibling[v] = -1;
+    if (p < 0)
+        return;
+    next_sibling[v] = first_child[p];
+    if (first_child[p] >= 0)
+        prev_sibling[first_child[p]] = v;
+    first_child[p] = v;
+}
+
+void TreeIndex::unlink(vertex_t v)
+{
+    vertex_t p = parent[v];
+    if (p < 0)
+        return;
+    if (prev_sibling[v] >= 0)
+        next_sibling[prev_sibling[v]] = next_sibling[v];
+    else
+        first_child[p] = next_sibling[v];
+    if (next_sibling[v] >= 0)
+        prev_sibling[next_sibling[v]] = prev_sibling[v];
+}
+
+void TreeIndex::fillJumps(const std::vector<vertex_t> &order)
+{
+    // order lists parents before children, so every ancestor's row is final
+    for (vertex_t v : order)
+    {
+        up[v] = (depth[v] > 0) ? parent[v] : -1;
+        for (int k = 1; k < levels; k++)
+        {
+            vertex_t mid = up[static_cast<size_t>(k - 1) * V + v];
+            up[static_cast<size_t>(k) * V + v] = (mid < 0) ? -1 : up[static_cast<size_t>(k - 1) * V + mid];
+        }
+    }
+}
+
+void TreeIndex::build(const std::vector<vertex_t> &parent, vertex_t source)
+{
+    V = parent.size();
+    this->source = source;
+    this->parent = parent;
+    depth.assign(V, -1);
+    first_child.assign(V, -1);
+    next_sibling.assign(V, -1);
+    prev_sibling.assign(V, -1);
+    mark.assign(V, 0);
+    // update() then works without growing its lists
+    for (auto *list : {&roots, &stale, &order})
+        list->reserve(V);
+    epoch = 0;
+    for (vertex_t v = 0; v < V; v++)
+        link(v);
+
+    std::vector<vertex_t> order;
+    int max_depth = 0;
+    if (source >= 0 && source < V)
+    {
+        depth[source] = 0;
+        order.push_back(source);
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            vertex_t v = order[i];
+            for (vertex_t c = first_child[v]; c >= 0; c = next_sibling[c])
+            {
+                depth[c] = depth[v] + 1;
+                max_depth = std::max(max_depth, depth[c]);
+                order.push_back(c);
+            }
+        }
+    }
+
+    // Enough levels for the deepest vertex; update() rebuilds if the tree
+    // ever grows past that
+    levels = 1;
+    while ((1 << levels) <= max_depth)
+        levels++;
+    up.assign(static_cast<size_t>(levels) * V, -1);
+    fillJumps(order);
+    last_recomputed = order.size();
+}
+
+void TreeIndex::update(const std::vector<vertex_t> &new_parent)
+{
+    if (static_cast<vertex_t>(new_parent.size()) != V)
+    {
+        build(new_parent, source);
+        return;
+    }
+
+    // Re-parent every vertex whose tree edge changed; each is the root of a
+    // subtree whose depths and jump pointers are now stale
+    roots.clear();
+    for (vertex_t v = 0; v < V; v++)
+    {
+        if (new_parent[v] != parent[v])
+        {
+            unlink(v);
+            parent[v] = new_parent[v];
+            link(v);
+            roots.push_back(v);
+        }
+    }
+    last_recomputed = 0;
+    if (roots.empty())
+        return;
+
+    // Collect the union of the stale subtrees
+    epoch++;
+    stale.clear();
+    for (vertex_t r : roots)
+    {
+        if (mark[r] == epoch)
+            continue;
+        mark[r] = epoch;
+        stale.push_back(r);
+        for (size_t i = stale.size() - 1; i < stale.size(); i++)
+        {
+            for (vertex_t c = first_child[stale[i]]; c >= 0; c = next_sibling[c])
+            {
+                if (mark[c] != epoch)
+                {
+                    mark[c] = epoch;
+                    stale.push_back(c);
+                }
+            }
+        }
+    }
+
+    // Recompute top-down from the stale vertices whose parent is still
+    // valid; anything not reached hangs off a cycle or nothing and is
+    // unreachable
+    order.clear();
+    for (vertex_t v : stale)
+    {
+        depth[v] = -1;
+        vertex_t p = parent[v];
+        if (v == source)
+        {
+            depth[v] = 0;
+            order.push_back(v);
+        }
+        else if (p >= 0 && mark[p] != epoch && depth[p] >= 0)
+        {
+            depth[v] = depth[p] + 1;
+            order.push_back(v);
+        }
+    }
+
+    int max_depth = 0;
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        vertex_t v = order[i];
+        max_depth = std::max(max_depth, depth[v]);
+        for (vertex_t c = first_child[v]; c >= 0; c = next_sibling[c])
+        {
+            depth[c] = depth[v] + 1;
+            order.push_back(c);
+        }
+    }
+
+    if (max_depth >= (1 << levels))
+    {
+        build(parent, source);
+        return;
+    }
+
+    for (vertex_t v : stale)
+    {
+        if (depth[v] < 0)
+        {
+            for (int k = 0; k < levels; k++)
+                up[static_cast<size_t>(k) * V + v] = -1;
+        }
+    }
+    fillJumps(order);
+    last_recomputed = stale.size();
+}
+
+int TreeIndex::hops(vertex_t v) const
+{
+    if (v < 0 || v >= V)
+        return -1;
+    return depth[v];
+}
+
+vertex_t TreeIndex::ancestor(vertex_t v, int k) const
+{
+    if (v < 0 || v >= V || k < 0 || k > depth[v])
+        return -1;
+    for (int b = 0; k > 0; b++, k >>= 1)
+    {
+        if (k & 1)
+            v = up[static_cast<size_t>(b) * V + v];
+    }
+    return v;
+}
+
+vertex_t TreeIndex::lca(vertex_t u, vertex_t v) const
+{
+    if (hops(u) < 0 || hops(v) < 0)
+        return -1;
+    if (depth[u] < depth[v])
+        std::swap(u, v);
+    u = ancestor(u, depth[u] - depth[v]);
+    if (u == v)
+        return u;
+    for (int k = levels - 1; k >= 0; k--)
+    {
+        size_t row = static_cast<size_t>(k) * V;
+        if (up[row + u] != up[row + v])
+        {
+            u = up[row + u];
+            v = up[row + v];
+        }
+    }
+    return parent[u];
+}
+
+std::vector<vertex_t> TreeIndex::path(vertex_t v) const
+{
+    // Source first, v last; the length is known up front from the depth
+    if (hops(v) < 0)
+        return {};
+    std::vector<vertex_t> result(depth[v] + 1);
+    for (int i = depth[v]; i >= 0; i--)
+    {
+        result[i] = v;
+        v = parent[v];
+    }
+    return result;
+}
+
+vertex_t TreeIndex::subtreeSize(vertex_t root, vertex_t limit) const
+{
+    // Pre-order walk over the sibling lists, climbing back through parent
+    // instead of keeping a stack
+    if (hops(root) < 0)
+        return 0;
+    vertex_t count = 0, v = root;
+    while (count < limit)
+    {
+        count++;
+        if (first_child[v] >= 0)
+        {
+            v = first_child[v];
+            continue;
+        }
+        while (v != root && next_sibling[v] < 0)
+            v = parent[v];
+        if (v == root)
+            break;
+        v = next_sibling[v];
+    }
+    return count;
+}
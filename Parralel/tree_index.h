@@ -0,0 +1,47 @@
+#ifndef TREE_INDEX_H
+#define TREE_INDEX_H
+
+#include "sssp_types.h"
+#include <vector>
+
+// Binary-lifting index over the shortest-path tree. Answers hop-count,
+// k-th ancestor, LCA and path queries without walking parent pointers one
+// hop at a time. update() only recomputes the subtrees whose root changed
+// parent since the last call.
+class TreeIndex
+{
+public:
+    vertex_t V = 0;
+    vertex_t source = -1;
+    int levels = 0;
+    std::vector<vertex_t> parent; // Tree the index currently describes
+    std::vector<int> depth;     // Hops from the source, -1 if unreachable
+    std::vector<vertex_t> up;  // up[k * V + v] = 2^k-th ancestor of v, -1 past the source
+
+    // Children as intrusive sibling lists so re-parenting a vertex is O(1)
+    std::vector<vertex_t> first_child;
+    std::vector<vertex_t> next_sibling;
+    std::vector<vertex_t> prev_sibling;
+
+    // Scratch for update()
+    std::vector<int> mark;
+    std::vector<vertex_t> roots, stale, order;
+    int epoch = 0;
+    long long last_recomputed = 0; // Vertices touched by the last build/update
+
+    void build(const std::vector<vertex_t> &parent, vertex_t source);
+    void update(const std::vector<vertex_t> &parent);
+
+    int hops(vertex_t v) const;
+    vertex_t ancestor(vertex_t v, int k) const;
+    vertex_t lca(vertex_t u, vertex_t v) const;
+    std::vector<vertex_t> path(vertex_t v) const;
+    // Vertices in v's subtree, v included, counting no further than limit
+    vertex_t subtreeSize(vertex_t v, vertex_t limit) const;
+
+    void link(vertex_t v);
+    void unlink(vertex_t v);
+    void fillJumps(const std::vector<vertex_t> &order);
+};
+
+#endif // TREE_INDEX_H
@@ -0,0 +1,228 @@
+#include "update_batch.h"
+#include <algorithm>
+
+// Keep only the net effect per undirected edge: the last update to (u,v)
+// wins, so repeated weight changes collapse into one and an insert followed
+// by a delete becomes a plain delete (dropped later if the edge never existed)
+std::vector<Edge> coalesceUpdates(const std::vector<Edge> &updates)
+{
+    std::vector<Edge> normalized(updates);
+    for (auto &e : normalized)
+    {
+        if (e.u > e.v)
+            std::swap(e.u, e.v);
+    }
+
+    std::stable_sort(normalized.begin(), normalized.end(),
+                     [](const Edge &a, const Edge &b)
+                     {
+                         return a.u < b.u || (a.u == b.u && a.v < b.v);
+                     });
+
+    std::vector<Edge> net;
+    net.reserve(normalized.size());
+    for (size_t i = 0; i < normalized.size(); i++)
+    {
+        bool last = i + 1 == normalized.size() ||
+                    normalized[i + 1].u != normalized[i].u ||
+                    normalized[i + 1].v != normalized[i].v;
+        if (last)
+            net.push_back(normalized[i]);
+    }
+    return net;
+}
+
+// Route each update to the ranks owning its endpoints (both, for cut edges),
+// sorted by owning rank and then by local vertex for locality. Only rank 0
+// holds the input; every rank receives its own share.
+std::vector<Edge> scatterUpdates(const Graph &graph, const std::vector<Edge> &updates,
+                                 MPI_Datatype edge_type, MPI_Comm comm)
+{
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    std::vector<int> counts(size, 0), displs(size, 0);
+    std::vector<Edge> routed;
+    if (rank == 0)
+    {
+        // (owner, local endpoint, index) keys for the locality sort
+        std::vector<std::pair<std::pair<int, vertex_t>, size_t>> keys;
+        keys.reserve(2 * updates.size());
+        for (size_t i = 0; i < updates.size(); i++)
+        {
+            const Edge &e = updates[i];
+            if (e.u < 0 || e.u >= graph.V || e.v < 0 || e.v >= graph.V)
+                continue;
+            int pu = graph.part[e.u], pv = graph.part[e.v];
+            keys.push_back({{pu, e.u}, i});
+            if (pv != pu)
+                keys.push_back({{pv, e.v}, i});
+        }
+        std::sort(keys.begin(), keys.end());
+
+        routed.reserve(keys.size());
+        for (const auto &key : keys)
+        {
+            routed.push_back(updates[key.second]);
+            counts[key.first.first]++;
+        }
+        for (int r = 1; r < size; r++)
+            displs[r] = displs[r - 1] + counts[r - 1];
+    }
+
+    int my_count = 0;
+    MPI_Scatter(counts.data(), 1, MPI_INT, &my_count, 1, MPI_INT, 0, comm);
+
+    std::vector<Edge> mine(my_count);
+    MPI_Scatterv(routed.data(), counts.data(), displs.data(), edge_type,
+                 mine.data(), my_count, edge_type, 0, comm);
+    return mine;
+}
+
+// Drop no-ops against the local view of the graph and split the remainder
+// into topology changes and Step 1 work. Every update here has at least one
+// local endpoint, so the adjacency needed for the checks is current.
+//
+// A weight change on an existing edge is neither an insertion nor a
+// deletion. A decrease can only lower distances, exactly like inserting the
+// lighter edge. An increase leaves every distance alone unless the edge is in
+// the tree, where it may strand the child's subtree.
+UpdateBatch classifyUpdates(const Graph &graph, const placed_vector<vertex_t> &parent,
+                            const std::vector<Edge> &updates, int rank)
+{
+    UpdateBatch batch;
+    batch.updates.reserve(updates.size());
+    auto tree_edge = [&](const Edge &e)
+    {
+        return (graph.part[e.u] == rank && parent[e.u] == e.v) ||
+               (graph.part[e.v] == rank && parent[e.v] == e.u);
+    };
+
+    for (const auto &e : updates)
+    {
+        bool u_local = graph.part[e.u] == rank;
+        vertex_t local = u_local ? e.u : e.v;
+        vertex_t other = u_local ? e.v : e.u;
+
+        float existing = graph.edgeWeight(local, other);
+
+        if (e.weight < 0)
+        {
+            if (existing < 0)
+            {
+                batch.dropped++;
+                continue;
+            }
+            batch.updates.push_back(e);
+
+            // Deleting a non-tree edge cannot change any distance
+            if (tree_edge(e))
+                batch.deletes.push_back({e.u, e.v, existing});
+        }
+        else
+        {
+            if (existing == e.weight)
+            {
+                batch.dropped++;
+                continue;
+            }
+            batch.updates.push_back(e);
+
+            if (existing < 0 || e.weight < existing)
+            {
+                batch.inserts.push_back(e);
+                if (existing >= 0)
+                    batch.decreases++;
+            }
+            else if (tree_edge(e))
+                batch.increases.push_back(e);
+        }
+    }
+    return batch;
+}
+
+const char *strategyName(UpdateStrategy strategy)
+{
+    switch (strategy)
+    {
+    case UPDATE_RECOMPUTE:
+        return "full recompute";
+    case UPDATE_DEVICE:
+        return "device offload";
+    case UPDATE_HIERARCHY:
+        return "contraction hierarchy";
+    default:
+        return "incremental";
+    }
+}
+
+// Step 2 visits the edges of every invalidated vertex about three times
+// (invalidation, the pull and at least one push round) and those of every
+// seed once per round it improves in. A label-correcting run from scratch
+// relaxes each directed edge about twice. The devices only pay off once
+// the work covers their upload and launch overhead.
+const double INCREMENTAL_VISITS = 3.0;
+const double RECOMPUTE_VISITS = 2.0;
+const double DEVICE_MIN_EDGE_VISITS = 1 << 20;
+
+BatchPlan planBatch(const Graph &graph, const TreeIndex &tree, const UpdateBatch &batch,
+                    bool device_available, MPI_Comm comm)
+{
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    // Each tree-edge deletion or increase strands at most the child's
+    // subtree, and this rank owns that child. Subtrees can nest, so the sum
+    // overestimates, and counting stops once it alone favours recomputing.
+    bool sized = tree.V == graph.V;
+    vertex_t limit = static_cast<vertex_t>(RECOMPUTE_VISITS / INCREMENTAL_VISITS * graph.V) + 1;
+    long long stranded = 0, roots = 0;
+    for (const auto *list : {&batch.deletes, &batch.increases})
+    {
+        for (const Edge &e : *list)
+        {
+            for (vertex_t child : {e.u, e.v})
+            {
+                vertex_t other = child == e.u ? e.v : e.u;
+                if (graph.part[child] != rank || !sized || tree.parent[child] != other)
+                    continue;
+                roots++;
+                if (stranded < limit)
+                    stranded += tree.subtreeSize(child, limit - static_cast<vertex_t>(stranded));
+            }
+        }
+    }
+    if (!sized)
+        stranded = roots = static_cast<long long>(batch.deletes.size() + batch.increases.size());
+
+    edge_t local_edges = 0;
+    for (vertex_t v : graph.local_vertices)
+        local_edges += graph.degree(v);
+    long long counts[4] = {stranded, static_cast<long long>(batch.inserts.size()), roots,
+                           static_cast<long long>(local_edges)};
+    MPI_Allreduce(MPI_IN_PLACE, counts, 4, MPI_LONG_LONG, MPI_SUM, comm);
+
+    BatchPlan plan;
+    double directed_edges = static_cast<double>(counts[3]);
+    double mean_degree = graph.V > 0 ? directed_edges / graph.V : 0;
+    plan.affected = std::min<long long>(counts[0] + counts[1], graph.V);
+    plan.incremental_cost = INCREMENTAL_VISITS * counts[0] * mean_degree + counts[1] * mean_degree;
+    plan.recompute_cost = RECOMPUTE_VISITS * directed_edges;
+    plan.recompute = plan.incremental_cost > plan.recompute_cost;
+    plan.strategy = plan.recompute ? UPDATE_RECOMPUTE : UPDATE_INCREMENTAL;
+
+    double work = std::min(plan.incremental_cost, plan.recompute_cost);
+    if (device_available && work >= DEVICE_MIN_EDGE_VISITS)
+        plan.strategy = UPDATE_DEVICE;
+
+    plan.reason = "~" + std::to_string(plan.affected) + " of " + std::to_string(graph.V) +
+                  " vertices affected (" + std::to_string(counts[0]) + " in " + std::to_string(counts[2]) +
+                  " stranded subtrees" + (sized ? "" : ", sizes unknown") + ", " +
+                  std::to_string(counts[1]) + " seeds); ~" +
+                  std::to_string(static_cast<long long>(plan.incremental_cost)) + " edge visits to repair vs ~" +
+                  std::to_string(static_cast<long long>(plan.recompute_cost)) + " to recompute";
+    if (device_available)
+        plan.reason += work >= DEVICE_MIN_EDGE_VISITS ? ", enough to offload" : ", too little to offload";
+    return plan;
+}
@@ -0,0 +1,55 @@
+#ifndef UPDATE_BATCH_H
+#define UPDATE_BATCH_H
+
+#include "graph.h"
+#include "numa_utils.h"
+#include "tree_index.h"
+#include <string>
+#include <vector>
+#include <mpi.h>
+
+// A rank's share of an update batch after preprocessing
+struct UpdateBatch
+{
+    std::vector<Edge> updates; // Net topology changes touching local vertices
+    std::vector<Edge> inserts;   // Step 1 insertions that may lower a distance
+    std::vector<Edge> deletes;   // Step 1 deletions of shortest-path tree edges
+    std::vector<Edge> increases; // Step 1 weight increases on tree edges, new weight
+    long long decreases = 0;     // Weight decreases among the inserts
+    long long dropped = 0;       // Updates that turned out to be no-ops
+};
+
+// How a batch is brought into the tree
+enum UpdateStrategy
+{
+    UPDATE_INCREMENTAL, // Step 1 and Step 2 on the CPU
+    UPDATE_RECOMPUTE,   // A fresh SSSP from the source
+    UPDATE_DEVICE,      // Either of the above, relaxed on the OpenCL devices
+    UPDATE_HIERARCHY    // Re-customized contraction hierarchy, tree rebuilt from it
+};
+
+// The cost model's verdict for one batch, the same on every rank
+struct BatchPlan
+{
+    UpdateStrategy strategy = UPDATE_INCREMENTAL;
+    bool recompute = false;     // Whether the devices start over from the source
+    long long affected = 0;     // Estimated vertices Step 1 invalidates or seeds
+    double incremental_cost = 0; // Estimated edge visits of each option
+    double recompute_cost = 0;
+    std::string reason;
+};
+
+const char *strategyName(UpdateStrategy strategy);
+
+std::vector<Edge> coalesceUpdates(const std::vector<Edge> &updates);
+std::vector<Edge> scatterUpdates(const Graph &graph, const std::vector<Edge> &updates,
+                                 MPI_Datatype edge_type, MPI_Comm comm);
+UpdateBatch classifyUpdates(const Graph &graph, const placed_vector<vertex_t> &parent,
+                            const std::vector<Edge> &updates, int rank);
+// Estimates what Step 1 would leave for Step 2 and picks the cheapest way
+// through the batch. tree must describe the tree before the batch; without
+// it only the seeds count. Collective.
+BatchPlan planBatch(const Graph &graph, const TreeIndex &tree, const UpdateBatch &batch,
+                    bool device_available, MPI_Comm comm);
+
+#endif // UPDATE_BATCH_H
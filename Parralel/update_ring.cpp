@@ -0,0 +1,243 @@
+#include "update_ring.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <thread>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef SSSP_64BIT_IDS
+static const char RING_MAGIC[8] = {'S', 'S', 'S', 'P', 'R', 'G', '6', '4'};
+#else
+static const char RING_MAGIC[8] = {'S', 'S', 'S', 'P', 'R', 'I', 'N', 'G'};
+#endif
+
+// Whether the process that stored pid has exited
+static bool processGone(int32_t pid)
+{
+    return pid != 0 && kill(pid, 0) != 0 && errno == ESRCH;
+}
+
+// Spins for a short while, then sleeps longer the longer the wait lasts
+static void backoff(int &spins)
+{
+    spins++;
+    if (spins < 128)
+        std::this_thread::yield();
+    else
+        std::this_thread::sleep_for(std::chrono::microseconds(spins < 1024 ? 50 : 1000));
+}
+
+bool UpdateRing::map(int fd, size_t bytes)
+{
+    void *addr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED)
+        return false;
+    header = static_cast<RingHeader *>(addr);
+    records = reinterpret_cast<Edge *>(static_cast<char *>(addr) + sizeof(RingHeader));
+    mapped = bytes;
+    return true;
+}
+
+bool UpdateRing::create(const std::string &ring_name, size_t capacity)
+{
+    close();
+    uint64_t slots = 1;
+    while (slots < capacity)
+        slots <<= 1;
+    size_t bytes = sizeof(RingHeader) + slots * sizeof(Edge);
+
+    // A segment left behind by a consumer that crashed is simply replaced
+    shm_unlink(ring_name.c_str());
+    int fd = shm_open(ring_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+    {
+        std::cerr << "Error creating shared-memory ring " << ring_name << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    bool ok = ftruncate(fd, bytes) == 0 && map(fd, bytes);
+    int error = errno;
+    ::close(fd);
+    if (!ok)
+    {
+        std::cerr << "Error sizing shared-memory ring " << ring_name << " to " << bytes << " bytes: "
+                  << std::strerror(error) << std::endl;
+        shm_unlink(ring_name.c_str());
+        return false;
+    }
+
+    // The segment comes zero-filled; the magic goes in last, so a producer
+    // that sees it sees the rest of the header too
+    new (header) RingHeader();
+    header->capacity = slots;
+    header->consumer.store(static_cast<int32_t>(getpid()));
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header->magic, RING_MAGIC, sizeof(RING_MAGIC));
+
+    name = ring_name;
+    owner = true;
+    ended = false;
+    mask = slots - 1;
+    next = other = 0;
+    return true;
+}
+
+bool UpdateRing::attach(const std::string &ring_name, int timeout_ms)
+{
+    close();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    for (;;)
+    {
+        int fd = shm_open(ring_name.c_str(), O_RDWR, 0);
+        struct stat st;
+        if (fd >= 0 && fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(RingHeader) &&
+            map(fd, st.st_size))
+        {
+            ::close(fd);
+            if (header->magic[0] != 0)
+                break;
+            munmap(header, mapped);
+            header = nullptr;
+        }
+        else if (fd >= 0)
+            ::close(fd);
+
+        if (std::chrono::steady_clock::now() >= deadline)
+        {
+            std::cerr << "Error: No shared-memory ring named " << ring_name
+                      << " (is sssp running with --ring=" << ring_name << "?)" << std::endl;
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    name = ring_name;
+
+    const char *problem = nullptr;
+    int32_t current = header->producer.load();
+    if (std::memcmp(header->magic, RING_MAGIC, sizeof(RING_MAGIC)) != 0)
+        problem = "was created with a different vertex ID width";
+    else if (mapped != sizeof(RingHeader) + header->capacity * sizeof(Edge))
+        problem = "has an inconsistent size";
+    else if (header->closed.load() || processGone(header->consumer.load()))
+        problem = "has no consumer any more";
+    else if (current != 0 && !processGone(current))
+        problem = "already has a producer";
+    else if (!header->producer.compare_exchange_strong(current, static_cast<int32_t>(getpid())))
+        problem = "was claimed by another producer";
+    if (problem)
+    {
+        std::cerr << "Error: Shared-memory ring " << ring_name << " " << problem << std::endl;
+        munmap(header, mapped);
+        header = nullptr;
+        return false;
+    }
+
+    mask = header->capacity - 1;
+    next = header->head.load(std::memory_order_acquire);
+    other = header->tail.load(std::memory_order_acquire);
+    return true;
+}
+
+bool UpdateRing::push(const Edge &update)
+{
+    // Full once the consumer is a whole ring behind
+    for (int spins = 0; next - other > mask;)
+    {
+        other = header->tail.load(std::memory_order_acquire);
+        if (next - other <= mask)
+            break;
+        if (header->closed.load() || consumerGone())
+            return false;
+        if (spins == 0)
+            header->stalls.fetch_add(1);
+        backoff(spins);
+    }
+    records[next & mask] = update;
+    header->head.store(++next, std::memory_order_release);
+    return true;
+}
+
+bool UpdateRing::endBatch()
+{
+    return push({RING_END_BATCH, RING_END_BATCH, 0}) && !header->closed.load() && !consumerGone();
+}
+
+bool UpdateRing::producerGone() const
+{
+    return processGone(header->producer.load());
+}
+
+// A consumer that crashed never set closed
+bool UpdateRing::consumerGone() const
+{
+    return processGone(header->consumer.load());
+}
+
+bool UpdateRing::nextBatch(std::vector<Edge> &batch)
+{
+    batch.clear();
+    if (!header || !owner || ended)
+        return false;
+
+    for (int spins = 0;;)
+    {
+        if (next == other)
+        {
+            other = header->head.load(std::memory_order_acquire);
+            if (next == other)
+            {
+                // Looking at head again after the producer is known to be
+                // gone catches records it wrote just before exiting
+                if (producerGone() && header->head.load(std::memory_order_acquire) == next)
+                {
+                    std::cerr << "Warning: Producer on " << name << " exited without ending the stream, "
+                              << "dropping " << batch.size() << " updates of an unfinished batch" << std::endl;
+                    batch.clear();
+                    ended = true;
+                    return false;
+                }
+                backoff(spins);
+                continue;
+            }
+            spins = 0;
+        }
+
+        // Slots go back to the producer as soon as they are copied out
+        while (next != other)
+        {
+            const Edge &record = records[next & mask];
+            if (record.u == RING_END_BATCH || record.u == RING_END_STREAM)
+            {
+                ended = record.u == RING_END_STREAM;
+                header->tail.store(++next, std::memory_order_release);
+                return !ended || !batch.empty();
+            }
+            batch.push_back(record);
+            next++;
+        }
+        header->tail.store(next, std::memory_order_release);
+    }
+}
+
+void UpdateRing::close()
+{
+    if (!header)
+        return;
+    if (owner)
+        header->closed.store(1);
+    else if (!header->closed.load() && !consumerGone())
+        push({RING_END_STREAM, RING_END_STREAM, 0});
+    munmap(header, mapped);
+    if (owner)
+        shm_unlink(name.c_str());
+    header = nullptr;
+    records = nullptr;
+    mapped = 0;
+    owner = false;
+}
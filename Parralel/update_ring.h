@@ -0,0 +1,86 @@
+#ifndef UPDATE_RING_H
+#define UPDATE_RING_H
+
+#include "graph.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Records whose u holds one of these are markers, not updates
+const vertex_t RING_END_BATCH = -1;  // The records before it form a batch
+const vertex_t RING_END_STREAM = -2; // The producer is done
+
+// Start of the shared-memory segment, followed by capacity raw Edge records.
+// head and tail count records ever written and consumed; each is stored by
+// one side only and sits on its own cache line.
+struct RingHeader
+{
+    char magic[8];     // "SSSPRING", or "SSSPRG64" with -DSSSP_64BIT_IDS; written last
+    uint64_t capacity; // Records, a power of two
+    std::atomic<int32_t> producer; // PID of the attached producer, 0 if none
+    std::atomic<int32_t> consumer; // PID of the process that created the ring
+    std::atomic<int32_t> closed;   // Set when the consumer detaches
+    std::atomic<uint64_t> stalls;  // Times the producer found the ring full
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+};
+
+// Single-producer, single-consumer ring of binary Edge records in POSIX
+// shared memory (shm_open), for streaming update batches into a running
+// sssp process without files or text parsing. The consumer creates the
+// segment and removes it again; a producer attaches by name.
+//
+// A full ring makes push() wait until the consumer has made room, so a fast
+// producer is held to the speed of the updates. Both sides spin briefly and
+// then sleep while waiting. The consumer also treats a producer that exited
+// without ending the stream as done, dropping its unfinished batch, and a
+// producer gives up on a consumer that exited without closing the ring.
+class UpdateRing
+{
+public:
+    static const size_t DEFAULT_CAPACITY = size_t(1) << 16;
+
+    UpdateRing() = default;
+    UpdateRing(const UpdateRing &) = delete;
+    UpdateRing &operator=(const UpdateRing &) = delete;
+    ~UpdateRing() { close(); }
+
+    // Consumer side: creates the ring, replacing a stale segment of that
+    // name. Capacity is rounded up to a power of two.
+    bool create(const std::string &name, size_t capacity = DEFAULT_CAPACITY);
+
+    // Next batch into batch; false once the stream has ended
+    bool nextBatch(std::vector<Edge> &batch);
+
+    // Producer side: attaches to the ring a consumer created, waiting up to
+    // timeout_ms for it to appear
+    bool attach(const std::string &name, int timeout_ms);
+
+    // False once the consumer has closed the ring or exited
+    bool push(const Edge &update);
+    bool endBatch();
+
+    // A producer ends the stream; the consumer unmaps and removes the ring
+    void close();
+
+    uint64_t producerStalls() const { return header ? header->stalls.load() : 0; }
+
+private:
+    bool map(int fd, size_t bytes);
+    bool producerGone() const;
+    bool consumerGone() const;
+
+    RingHeader *header = nullptr;
+    Edge *records = nullptr;
+    size_t mapped = 0;
+    uint64_t mask = 0;
+    std::string name;
+    bool owner = false;  // Created the segment, so consumes from it
+    bool ended = false;  // Consumer saw the end of the stream
+    uint64_t next = 0;   // Producer's head or consumer's tail
+    uint64_t other = 0;  // Last seen position of the other side
+};
+
+#endif // UPDATE_RING_H
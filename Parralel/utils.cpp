@@ -1,11 +1,72 @@
 #include "utils.h"
+#include "halo_exchange.h"
+#include "mpi_chunked.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
-#include <iomanip>
+#include <algorithm>
+#include <charconv>
 #include <limits>
 #include <string>
 
+bool parseUpdateLine(std::string line, Edge &e, const char *&error)
+{
+    error = nullptr;
+    if (line.empty())
+        return false;
+
+    // An optional type comes first: I(nsert), D(elete) or W(eight
+    // change). Weight changes are told apart from insertions by
+    // classifyUpdates, against the graph, so I and W parse the same.
+    char type = 0;
+    if ((line[0] == 'I' || line[0] == 'D' || line[0] == 'W') && line.size() > 1 && isspace(line[1]))
+    {
+        type = line[0];
+        line.erase(0, 1);
+        line.erase(0, line.find_first_not_of(" \t"));
+    }
+
+    // Skip comment lines or lines that don't start with a digit
+    if (line.empty() || line[0] == '#' || !isdigit(line[0]))
+        return false;
+
+    // Try to parse the line as "u v weight"
+    std::istringstream iss(line);
+    if (!(iss >> e.u >> e.v))
+    {
+        error = "Malformed update line";
+        return false;
+    }
+    if (type == 'D')
+    {
+        e.weight = -1.0f;
+        return true;
+    }
+    std::string weight_str;
+    if (!(iss >> weight_str))
+    {
+        error = "Missing weight in update line";
+        return false;
+    }
+
+    // Check if it's a removal (marked with '-')
+    if (weight_str == "-")
+    {
+        e.weight = -1.0f; // Using -1 to indicate removal
+        return true;
+    }
+    try
+    {
+        e.weight = std::stof(weight_str);
+    }
+    catch (const std::exception &ex)
+    {
+        error = "Error parsing weight in line";
+        return false;
+    }
+    return true;
+}
+
 std::vector<Edge> loadUpdates(const std::string &filename)
 {
     std::vector<Edge> updates;
@@ -19,49 +80,16 @@ std::vector<Edge> loadUpdates(const std::string &filename)
     std::string line;
     while (std::getline(file, line))
     {
-        // Skip empty lines
-        if (line.empty())
-            continue;
-
-        // Skip comment lines or lines that don't start with a digit
-        if (line[0] == '#' || !isdigit(line[0]))
-            continue;
-
-        std::istringstream iss(line);
         Edge e;
-
-        // Try to parse the line as "u v weight"
-        if (iss >> e.u >> e.v)
+        const char *error;
+        if (parseUpdateLine(line, e, error))
         {
-            std::string weight_str;
-            if (iss >> weight_str)
-            {
-                // Check if it's a removal (marked with '-')
-                if (weight_str == "-")
-                {
-                    e.weight = -1.0f; // Using -1 to indicate removal
-                }
-                else
-                {
-                    try
-                    {
-                        // Try to parse as float
-                        e.weight = std::stof(weight_str);
-                    }
-                    catch (const std::exception &ex)
-                    {
-                        std::cerr << "Error parsing weight in line: " << line << std::endl;
-                        continue; // Skip this malformed line
-                    }
-                }
-
-                updates.push_back(e);
-                std::cout << "Loaded update: " << e.u << " " << e.v << " " << e.weight << std::endl;
-            }
+            updates.push_back(e);
+            std::cout << "Loaded update: " << e.u << " " << e.v << " " << e.weight << std::endl;
         }
-        else
+        else if (error)
         {
-            std::cerr << "Malformed update line: " << line << std::endl;
+            std::cerr << error << ": " << line << std::endl;
         }
     }
 
@@ -69,24 +97,203 @@ std::vector<Edge> loadUpdates(const std::string &filename)
     return updates;
 }
 
-void saveResults(const std::string &filename, const std::vector<float> &dist)
+// Formats "index distance" lines for vertices [first, last) into out, using
+// the same two-decimal fixed notation as the original stream writer
+static void formatResults(const float *dist, size_t first, size_t last, std::string &out)
 {
-    std::ofstream file(filename);
+    char line[64];
+    out.clear();
+    out.reserve((last - first) * 16);
+    for (size_t i = first; i < last; i++)
+    {
+        char *p = std::to_chars(line, line + sizeof(line), i).ptr;
+        *p++ = ' ';
+        p = std::to_chars(p, line + sizeof(line), dist[i - first], std::chars_format::fixed, 2).ptr;
+        *p++ = '\n';
+        out.append(line, p);
+    }
+}
+
+std::vector<float> loadResults(const std::string &filename, vertex_t V)
+{
+    std::vector<float> dist(V, std::numeric_limits<float>::infinity());
+    std::ifstream file(filename);
+    if (!file.is_open())
+    {
+        std::cerr << "Error opening results file: " << filename << std::endl;
+        dist.clear();
+        return dist;
+    }
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream iss(line);
+        long long v;
+        std::string value;
+        if (!(iss >> v >> value) || v < 0 || v >= V)
+            continue;
+        try
+        {
+            dist[v] = std::stof(value);
+        }
+        catch (const std::exception &ex)
+        {
+            // Unparsable values stay infinite
+        }
+    }
+    return dist;
+}
+
+void saveResults(const std::string &filename, const std::vector<float> &dist, bool use_openmp)
+{
+    std::ofstream file(filename, std::ios::binary);
     if (!file.is_open())
     {
         std::cerr << "Error opening output file: " << filename << std::endl;
         return;
     }
 
-    for (size_t i = 0; i < dist.size(); i++)
+    // Format large chunks in parallel, then write them out in order
+    const size_t CHUNK = 1 << 20;
+    size_t num_chunks = (dist.size() + CHUNK - 1) / CHUNK;
+    std::vector<std::string> buffers(num_chunks);
+
+#pragma omp parallel for schedule(dynamic) if (use_openmp)
+    for (size_t c = 0; c < num_chunks; c++)
     {
-        file << i << " " << std::fixed << std::setprecision(2) << dist[i] << "\n";
+        size_t first = c * CHUNK;
+        size_t last = std::min(dist.size(), first + CHUNK);
+        formatResults(dist.data() + first, first, last, buffers[c]);
     }
+
+    for (const auto &buf : buffers)
+    {
+        file.write(buf.data(), buf.size());
+    }
+}
+
+void saveResultsBinary(const std::string &filename, const std::vector<float> &dist)
+{
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cerr << "Error opening output file: " << filename << std::endl;
+        return;
+    }
+
+    ResultsHeader header = {{'S', 'S', 'S', 'P', 'D', 'I', 'S', 'T'}, dist.size()};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(dist.data()), sizeof(float) * dist.size());
+}
+
+void saveResultsMPIIO(const std::string &filename, const Graph &graph,
+                      const std::vector<float> &dist, bool binary, MPI_Comm comm)
+{
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    MPI_File fh;
+    if (MPI_File_open(comm, filename.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                      MPI_INFO_NULL, &fh) != MPI_SUCCESS)
+    {
+        if (rank == 0)
+            std::cerr << "Error opening output file: " << filename << std::endl;
+        return;
+    }
+    MPI_File_set_size(fh, 0);
+
+    if (binary)
+    {
+        // Every rank writes its own (scattered) vertices straight into place
+        // through an indexed file view behind the header
+        ResultsHeader header = {{'S', 'S', 'S', 'P', 'D', 'I', 'S', 'T'},
+                                static_cast<uint64_t>(graph.V)};
+        if (rank == 0)
+            MPI_File_write_at(fh, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE);
+
+        std::vector<vertex_t> local(graph.local_vertices);
+        std::sort(local.begin(), local.end());
+        std::vector<float> values(local.size());
+        std::vector<MPI_Aint> displacements(local.size());
+        for (size_t i = 0; i < local.size(); i++)
+        {
+            values[i] = dist[local[i]];
+            displacements[i] = static_cast<MPI_Aint>(local[i]) * sizeof(float);
+        }
+
+        // Byte displacements, so vertex IDs past 2^31 still address correctly.
+        // A view takes an int count, so it covers SSSP_MPI_CHUNK vertices at
+        // a time; the writes are collective, so every rank joins each round.
+        int64_t rounds = (static_cast<int64_t>(local.size()) + SSSP_MPI_CHUNK - 1) / SSSP_MPI_CHUNK;
+        MPI_Allreduce(MPI_IN_PLACE, &rounds, 1, MPI_INT64_T, MPI_MAX, comm);
+        for (int64_t i = 0; i < rounds; i++)
+        {
+            size_t done = std::min<size_t>(i * SSSP_MPI_CHUNK, local.size());
+            int n = static_cast<int>(std::min<size_t>(SSSP_MPI_CHUNK, local.size() - done));
+            MPI_Datatype filetype;
+            MPI_Type_create_hindexed_block(n, 1, displacements.data() + done, MPI_FLOAT, &filetype);
+            MPI_Type_commit(&filetype);
+            MPI_File_set_view(fh, sizeof(header), MPI_FLOAT, filetype, "native", MPI_INFO_NULL);
+            MPI_File_write_all(fh, values.data() + done, n, MPI_FLOAT, MPI_STATUS_IGNORE);
+            MPI_Type_free(&filetype);
+        }
+    }
+    else
+    {
+        // Text lines have variable length, so first move distances to
+        // contiguous vertex blocks, then format each block and write it at
+        // the offset given by the lengths of all preceding blocks
+        std::vector<vertex_t> block_start(size + 1);
+        for (int r = 0; r <= size; r++)
+            block_start[r] = static_cast<int64_t>(graph.V) * r / size;
+        auto block_of = [&](vertex_t v)
+        { return static_cast<int>(std::upper_bound(block_start.begin(), block_start.end(), v) - block_start.begin()) - 1; };
+
+        std::vector<int64_t> send_counts(size, 0), recv_counts(size), send_displs(size, 0);
+        for (vertex_t v : graph.local_vertices)
+            send_counts[block_of(v)]++;
+        for (int r = 1; r < size; r++)
+            send_displs[r] = send_displs[r - 1] + send_counts[r - 1];
+
+        std::vector<BoundaryUpdate> outgoing(graph.local_vertices.size());
+        std::vector<int64_t> fill(send_displs);
+        for (vertex_t v : graph.local_vertices)
+        {
+            int b = block_of(v);
+            outgoing[fill[b]++] = {dist[v], v};
+        }
+
+        MPI_Alltoall(send_counts.data(), 1, MPI_INT64_T, recv_counts.data(), 1, MPI_INT64_T, comm);
+        int64_t incoming_count = 0;
+        for (int64_t c : recv_counts)
+            incoming_count += c;
+        std::vector<BoundaryUpdate> incoming(incoming_count);
+        alltoallvChunked(outgoing.data(), send_counts, incoming.data(), recv_counts,
+                         boundaryUpdateType(), comm);
+
+        size_t first = block_start[rank], last = block_start[rank + 1];
+        std::vector<float> block(last - first, std::numeric_limits<float>::infinity());
+        for (const auto &entry : incoming)
+            block[entry.vertex - first] = entry.dist;
+
+        std::string text;
+        formatResults(block.data(), first, last, text);
+
+        long long length = text.size(), offset = 0;
+        MPI_Exscan(&length, &offset, 1, MPI_LONG_LONG, MPI_SUM, comm);
+        if (rank == 0)
+            offset = 0;
+        writeAtAllChunked(fh, offset, text.data(), text.size(), MPI_CHAR, comm);
+    }
+
+    MPI_File_close(&fh);
 }
 
 void printStats(const std::vector<float> &dist)
 {
-    int reachable = 0;
+    int64_t reachable = 0;
     float max_dist = 0;
     float sum_dist = 0;
 
@@ -105,4 +312,34 @@ void printStats(const std::vector<float> &dist)
     std::cout << "  Reachable vertices: " << reachable << "/" << dist.size() << "\n";
     std::cout << "  Maximum distance: " << max_dist << "\n";
     std::cout << "  Average distance: " << (reachable > 0 ? sum_dist / reachable : 0) << "\n";
+}
+
+void printStatsDistributed(const Graph &graph, const std::vector<float> &dist, MPI_Comm comm)
+{
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    // Same figures as printStats, reduced from the owned vertices only
+    double local_sums[2] = {0, 0}, global_sums[2];
+    float local_max = 0, global_max;
+    for (vertex_t v : graph.local_vertices)
+    {
+        if (dist[v] < std::numeric_limits<float>::infinity())
+        {
+            local_sums[0]++;
+            local_sums[1] += dist[v];
+            if (dist[v] > local_max)
+                local_max = dist[v];
+        }
+    }
+    MPI_Reduce(local_sums, global_sums, 2, MPI_DOUBLE, MPI_SUM, 0, comm);
+    MPI_Reduce(&local_max, &global_max, 1, MPI_FLOAT, MPI_MAX, 0, comm);
+
+    if (rank == 0)
+    {
+        std::cout << "SSSP Statistics:\n";
+        std::cout << "  Reachable vertices: " << static_cast<long long>(global_sums[0]) << "/" << graph.V << "\n";
+        std::cout << "  Maximum distance: " << global_max << "\n";
+        std::cout << "  Average distance: " << (global_sums[0] > 0 ? global_sums[1] / global_sums[0] : 0) << "\n";
+    }
 }
\ No newline at end of file
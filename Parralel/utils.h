@@ -3,9 +3,29 @@
 #include "graph.h"
 #include <vector>
 #include <string>
+#include <cstdint>
+#include <mpi.h>
 
+// Header of the binary results file, followed by V raw floats
+struct ResultsHeader
+{
+    char magic[8]; // "SSSPDIST"
+    uint64_t num_vertices;
+};
+
+// Parses one updates-file line, "[I|D|W] u v w", into e. Returns false
+// for lines that hold no update; error then says why if the line was
+// malformed rather than blank or a comment.
+bool parseUpdateLine(std::string line, Edge &e, const char *&error);
 std::vector<Edge> loadUpdates(const std::string &filename);
-void saveResults(const std::string &filename, const std::vector<float> &dist);
+void saveResults(const std::string &filename, const std::vector<float> &dist, bool use_openmp = false);
+// Reads "index distance" lines as saveResults and the Sequencial baseline
+// write them; vertices the file does not list stay infinite
+std::vector<float> loadResults(const std::string &filename, vertex_t V);
+void saveResultsBinary(const std::string &filename, const std::vector<float> &dist);
+void saveResultsMPIIO(const std::string &filename, const Graph &graph,
+                      const std::vector<float> &dist, bool binary, MPI_Comm comm);
 void printStats(const std::vector<float> &dist);
+void printStatsDistributed(const Graph &graph, const std::vector<float> &dist, MPI_Comm comm);
 
 #endif // UTILS_H
\ No newline at end of file
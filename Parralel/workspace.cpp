@@ -0,0 +1,35 @@
+#include "workspace.h"
+#include <algorithm>
+
+void Workspace::reserve(vertex_t V)
+{
+    if (sized_for == V)
+        return;
+    sized_for = V;
+
+    // A frontier, its successor and the repaired list each hold a vertex
+    // at most once per round; longer runs still grow them, once
+    for (auto *list : {&frontier, &next, &repaired})
+    {
+        list->clear();
+        list->shrink_to_fit();
+        list->reserve(V);
+    }
+    arrived.clear();
+    heap.clear();
+    heap.reserve(V);
+    per_thread.clear();
+}
+
+std::vector<placed_vector<vertex_t>> &Workspace::threadLists(size_t threads)
+{
+    if (per_thread.size() < threads)
+    {
+        per_thread.resize(threads);
+        for (auto &list : per_thread)
+            list.reserve(std::max<vertex_t>(sized_for, 0));
+    }
+    for (auto &list : per_thread)
+        list.clear();
+    return per_thread;
+}
@@ -0,0 +1,60 @@
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include "sssp_types.h"
+#include "graph.h"
+#include "halo_exchange.h"
+#include "numa_utils.h"
+#include <CL/cl.h>
+#include <utility>
+#include <vector>
+
+// Scratch space for Step 1 and Step 2, owned by SSSP. The vertex-sized
+// buffers are reserved once per graph and everything is only cleared
+// between rounds and batches. clear() keeps a vector's capacity, so after
+// the initial SSSP an update batch does not touch the heap here.
+struct Workspace
+{
+    vertex_t sized_for = -1;
+
+    std::vector<vertex_t> frontier;
+    std::vector<vertex_t> next;
+    std::vector<vertex_t> repaired;
+    std::vector<BoundaryUpdate> arrived;
+
+    // Priority queue of the sequential Phase 2, kept as a heap
+    std::vector<std::pair<float, vertex_t>> heap;
+
+    // One list per OpenMP thread for what a parallel loop produces. A
+    // thread may list every vertex in a round, so each is reserved for V;
+    // the reservation is mapped lazily and only the pages a thread fills
+    // become resident.
+    std::vector<placed_vector<vertex_t>> per_thread;
+
+    // Frontier exchanged with each OpenCL device, and the improvements that
+    // other devices still have to hear about (vertex, device that made it)
+    std::vector<std::vector<cl_int>> device_ids;
+    std::vector<std::vector<float>> device_dist;
+    std::vector<std::pair<vertex_t, int>> cross_device;
+    std::vector<cl_uint> device_edges;
+
+    // The batch as applied on the devices: copies kept for the host to
+    // redo Step 1 if a device fails, packed endpoints (deletions first), and
+    // parents in the devices' index type when vertex_t is wider
+    std::vector<Edge> batch_inserts, batch_deletes;
+
+    // Deletions plus the weight increases Step 1 could not re-parent
+    std::vector<Edge> invalidating;
+    std::vector<cl_int> device_ends;
+    std::vector<float> device_weights;
+    cl_uint device_deletes = 0;
+    placed_vector<cl_int> device_parent;
+
+    // Reserves the vertex-sized buffers; a no-op if already sized for V
+    void reserve(vertex_t V);
+
+    // threads empty lists, reusing the ones from earlier calls
+    std::vector<placed_vector<vertex_t>> &threadLists(size_t threads);
+};
+
+#endif // WORKSPACE_H